@@ -1,2 +1,38 @@
 #pragma once
 #include "JJS.h"
+
+#if JJS_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace JJS
+{
+static void* countedAllocate(std::size_t size) noexcept
+{
+    threadAllocationCounts.allocations++;
+    threadAllocationCounts.bytes += size;
+    return std::malloc(size != 0 ? size : 1);
+}
+} // JJS
+
+void* operator new(std::size_t size)
+{
+    if (void* memory = JJS::countedAllocate(size))
+        return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size)
+{
+    if (void* memory = JJS::countedAllocate(size))
+        return memory;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return JJS::countedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return JJS::countedAllocate(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+#endif
@@ -14,8 +14,33 @@ END_JUCE_MODULE_DECLARATION
 */
 
 #pragma once
+
+/** Config: JJS_ENABLE_USDT_PROBES
+    Adds SystemTap/USDT probe points at every job lifecycle point on Linux, so perf and bpftrace can trace JJS. Needs sys/sdt.h from systemtap-sdt-dev.
+*/
+#ifndef JJS_ENABLE_USDT_PROBES
+ #define JJS_ENABLE_USDT_PROBES 0
+#endif
+
+/** Config: JJS_INSTRUMENT_LOCKS
+    Records acquisition counts, contended acquisitions and wait time histograms for the JobSystem and ScopedFunctionContainer locks, see JJS::getLockStatistics().
+*/
+#ifndef JJS_INSTRUMENT_LOCKS
+ #define JJS_INSTRUMENT_LOCKS 0
+#endif
+
+/** Config: JJS_COUNT_ALLOCATIONS
+    Replaces the global operator new in JJS.cpp to count allocations per thread, so job type and worker statistics report how many allocations and bytes each job made while it ran.
+    Leave this off if your application replaces operator new itself.
+*/
+#ifndef JJS_COUNT_ALLOCATIONS
+ #define JJS_COUNT_ALLOCATIONS 0
+#endif
+
 #include <juce_core/juce_core.h>
 #include <juce_events/juce_events.h>
 #include <JuceHeader.h>
 #include "Source/JobSystem.h"
 #include "Source/CallbackMap.h"
+#include "Source/JobSampler.h"
+#include "Source/Simulation.h"
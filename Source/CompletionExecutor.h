@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    CompletionExecutor.h
+    Created: 18 Oct 2026 8:03:37pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "LockFreeFifo.h"
+#include "InstrumentedLock.h"
+
+namespace JJS
+{
+
+/**
+ Runs job completions somewhere other than the message thread, so listeners that live on another thread get their callbacks without a second hop.
+ Jobs use the message thread unless given an executor with Job::setCompletionExecutor() or JobSystem::setCallbackExecutor().
+ post() is called from worker threads, and from the scheduler for dropped jobs. Completions must run before the JobSystem that posted them is destroyed.
+ */
+class CompletionExecutor
+{
+public:
+    virtual ~CompletionExecutor() = default;
+    virtual void post(std::function<void()>&& completion) = 0;
+};
+
+/**
+ Runs completions straight away on the worker that finished the job. Callbacks must be thread safe and short, they hold up the worker.
+ */
+class InlineExecutor : public CompletionExecutor
+{
+public:
+    void post(std::function<void()>&& completion) override { completion(); }
+};
+
+/**
+ Runs completions one at a time, in the order they were posted, on its own named thread, e.g. a model or database thread.
+ Completions still queued when it is destroyed are discarded.
+ */
+class StrandExecutor : public CompletionExecutor, private juce::Thread
+{
+public:
+    explicit StrandExecutor(const juce::String& thread_name) : juce::Thread(thread_name) { startThread(); }
+    ~StrandExecutor() override { stopThread(1000); }
+    
+    void post(std::function<void()>&& completion) override
+    {
+        {
+            ScopedLock lock(criticalSection);
+            queued.push_back(std::move(completion));
+        }
+        notify();
+    }
+    
+private:
+    void run() override
+    {
+        std::vector<std::function<void()>> running;
+        while (!threadShouldExit())
+        {
+            {
+                ScopedLock lock(criticalSection);
+                std::swap(running, queued);
+            }
+            if (running.empty())
+            {
+                wait(-1);
+                continue;
+            }
+            for (std::function<void()>& completion : running)
+                completion();
+            running.clear();
+        }
+    }
+    
+    std::vector<std::function<void()>> queued;
+    CriticalSection criticalSection { "StrandExecutor" };
+};
+
+/**
+ Queues completions for a thread that polls, e.g. the audio thread at the start of each block. Posting locks, drain() never waits on a worker.
+ Completions past the capacity spill into an overflow that a later drain() picks up, so nothing is lost.
+ drain() neither allocates nor frees: a completion that has run, with the last reference to its job, is handed back and released by the next post() or releaseCompleted().
+ A completion that triggers a ScopedFunctionContainer takes that container's lock, so drain() can wait for a component adding or removing a scope on another thread.
+ */
+class PolledExecutor : public CompletionExecutor
+{
+public:
+    explicit PolledExecutor(int capacity = 1024) : completions(capacity), completed(capacity)
+    {
+        drainingOverflow.reserve(static_cast<size_t>(capacity));
+    }
+    
+    void post(std::function<void()>&& completion) override
+    {
+        auto queued = std::make_unique<std::function<void()>>(std::move(completion));
+        {
+            ScopedLock lock(postLock); // Workers post concurrently, the FIFO takes one producer at a time
+            if (hasOverflow.load() || !completions.push(std::move(queued)))
+            {
+                overflow.push_back(std::move(queued));
+                hasOverflow.store(true);
+            }
+        }
+        juce::GenericScopedTryLock<CriticalSection> lock(releaseLock);
+        if (lock.isLocked())
+            releaseCompletedLocked();
+    }
+    
+    /**
+     Runs completions posted so far, in order, and returns how many ran. Only call it from one thread.
+     Stops early, leaving the rest for the next drain, once capacity completions are waiting to be released.
+     */
+    int drain()
+    {
+        int numRun = 0;
+        while (completions.getNumItems() > 0 && completed.getFreeSpace() > 0)
+        {
+            std::unique_ptr<std::function<void()>> completion = completions.pop();
+            (*completion)();
+            completed.push(std::move(completion));
+            numRun++;
+        }
+        while (hasOverflow.load() && completions.getNumItems() == 0)
+        {
+            const size_t numReleasable = static_cast<size_t>(completed.getFreeSpace());
+            if (numReleasable == 0)
+                return numRun;
+            {
+                juce::GenericScopedTryLock<CriticalSection> lock(postLock);
+                if (!lock.isLocked())
+                    return numRun; // A worker is posting, the overflow waits for the next drain
+                const size_t batchSize = juce::jmin(numReleasable, drainingOverflow.capacity());
+                while (completions.getNumItems() > 0 && drainingOverflow.size() < batchSize) // Posted before the overflow started
+                    drainingOverflow.push_back(completions.pop());
+                const size_t numTaken = juce::jmin(overflow.size(), batchSize - drainingOverflow.size());
+                for (size_t i = 0; i < numTaken; ++i)
+                    drainingOverflow.push_back(std::move(overflow[i]));
+                overflow.erase(overflow.begin(), overflow.begin() + static_cast<std::ptrdiff_t>(numTaken)); // Keeps its capacity
+                if (overflow.empty() && completions.getNumItems() == 0)
+                    hasOverflow.store(false);
+            }
+            for (std::unique_ptr<std::function<void()>>& completion : drainingOverflow)
+            {
+                (*completion)();
+                completed.push(std::move(completion));
+            }
+            numRun += static_cast<int>(drainingOverflow.size());
+            drainingOverflow.clear();
+        }
+        return numRun;
+    }
+    
+    /**
+     Frees completions that drain() has run, along with the jobs they held. Call it from any thread but the draining one, e.g. a timer on the message thread, when no more jobs are being posted.
+     */
+    void releaseCompleted()
+    {
+        ScopedLock lock(releaseLock);
+        releaseCompletedLocked();
+    }
+    
+    bool hasPending() const { return completions.getNumItems() > 0 || hasOverflow.load(); }
+    
+private:
+    void releaseCompletedLocked()
+    {
+        while (completed.getNumItems() > 0)
+            completed.pop();
+    }
+    
+    LockFreeFifo<std::unique_ptr<std::function<void()>>> completions;
+    std::vector<std::unique_ptr<std::function<void()>>> overflow;
+    std::vector<std::unique_ptr<std::function<void()>>> drainingOverflow; // Drain thread only, reserved to the capacity
+    LockFreeFifo<std::unique_ptr<std::function<void()>>> completed; // Run by drain(), waiting to be freed off the draining thread
+    std::atomic<bool> hasOverflow { false };
+    CriticalSection postLock { "PolledExecutor" };
+    CriticalSection releaseLock { "PolledExecutor Release" };
+};
+
+} // JJS
@@ -0,0 +1,262 @@
+/*
+  ==============================================================================
+
+    FlightRecorder.h
+    Created: 18 Oct 2026 2:20:14pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+namespace JJS
+{
+
+/**
+ Always-on binary ring of scheduler events, written into a memory-mapped file so it survives a hang or crash.
+ Each lane is its own ring, so workers never contend with each other. Recording an event is one atomic increment and a 32 byte store.
+ Job tags are stored once in a small name table inside the same file, events only carry the 32 bit tag id.
+
+ Usage:
+ 1. Call JobSystem::enableFlightRecorder() with a file before pushing jobs.
+ 2. After a freeze, call FlightRecorder::decode() on that file to get a timeline of the last few seconds.
+    After a crash and restart, the recording has been moved to getPreviousSessionFile(), decode that one instead.
+ */
+class FlightRecorder
+{
+public:
+    enum EventType : juce::uint8
+    {
+        Push,
+        Dispatch,
+        Start,
+        Finish,
+        Callback,
+        Drop
+    };
+
+    enum Lane
+    {
+        ProducerLane,
+        SchedulerLane,
+        MessageThreadLane,
+        FirstWorkerLane
+    };
+
+    /**
+     Where the recording of the previous session is kept. Opening a recorder on a file moves the old recording here before starting a new one.
+     */
+    static juce::File getPreviousSessionFile(const juce::File& file) { return file.getSiblingFile(file.getFileName() + ".previous"); }
+
+    FlightRecorder(const juce::File& file, int num_workers, int events_per_lane)
+    : numLanes(static_cast<juce::uint32>(FirstWorkerLane + num_workers)), eventsPerLane(static_cast<juce::uint32>(juce::jmax(1, events_per_lane)))
+    {
+        // The previous session is what you decode after a crash and restart, keep it beside the new one
+        if (file.existsAsFile())
+        {
+            const juce::File previousFile = getPreviousSessionFile(file);
+            previousFile.deleteFile();
+            if (!file.moveFileTo(previousFile))
+                file.deleteFile();
+        }
+        {
+            juce::FileOutputStream stream(file);
+            if (!stream.openedOk())
+                return;
+            Header header;
+            std::memcpy(header.magic, fileMagic, sizeof(header.magic));
+            header.numLanes = numLanes;
+            header.eventsPerLane = eventsPerLane;
+            header.ticksPerSecond = juce::Time::getHighResolutionTicksPerSecond();
+            stream.write(&header, sizeof(Header));
+            stream.writeRepeatedByte(0, getFileSize(numLanes, eventsPerLane) - sizeof(Header));
+            stream.flush();
+        }
+        mappedFile = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readWrite, false);
+        if (mappedFile->getData() == nullptr || mappedFile->getSize() < getFileSize(numLanes, eventsPerLane))
+            mappedFile.reset();
+    }
+
+    bool isOpen() const { return mappedFile != nullptr; }
+    /**
+     Bytes of the mapped file. These are file backed pages, so the OS can write them out under memory pressure.
+     */
+    size_t getMemoryUsage() const { return mappedFile != nullptr ? mappedFile->getSize() : 0; }
+
+    /**
+     Adds a tag to the file's name table the first time its id is seen, later calls are a single load.
+     */
+    void registerTag(juce::uint32 tag_id, const char* category, const char* name)
+    {
+        if (mappedFile == nullptr || tag_id == 0)
+            return;
+        TagEntry* entries = getTagTable(mappedFile->getData());
+        for (juce::uint32 probe = 0; probe < numTagEntries; ++probe)
+        {
+            TagEntry& entry = entries[(tag_id + probe) % numTagEntries];
+            juce::uint32 existing = entry.id.load(std::memory_order_acquire);
+            if (existing == tag_id)
+                return;
+            if (existing == 0 && entry.id.compare_exchange_strong(existing, tag_id, std::memory_order_acq_rel))
+            {
+                juce::String text = category != nullptr ? juce::String(category) + "/" : juce::String();
+                text << (name != nullptr ? name : "Unnamed Job");
+                text.copyToUTF8(entry.name, sizeof(entry.name));
+                return;
+            }
+            if (existing == tag_id)
+                return;
+        }
+    }
+
+    void record(int lane, EventType type, juce::uint64 job_id, int priority, juce::uint32 tag_id = 0)
+    {
+        if (mappedFile == nullptr || lane < 0 || static_cast<juce::uint32>(lane) >= numLanes)
+            return;
+        juce::uint8* laneData = getLane(mappedFile->getData(), static_cast<juce::uint32>(lane), eventsPerLane);
+        const juce::uint64 index = reinterpret_cast<std::atomic<juce::uint64>*>(laneData)->fetch_add(1, std::memory_order_relaxed);
+        Event& event = reinterpret_cast<Event*>(laneData + laneHeaderSize)[index % eventsPerLane];
+        event.ticks = juce::Time::getHighResolutionTicks();
+        event.jobId = job_id;
+        event.tag = tag_id;
+        event.type = type;
+        event.priority = static_cast<juce::int8>(priority);
+        event.lane = static_cast<juce::uint16>(lane);
+        std::atomic_thread_fence(std::memory_order_release);
+        event.sequence = static_cast<juce::uint32>(index + 1);
+    }
+
+    /**
+     Turns the last seconds of a flight recorder file into a readable timeline, one event per line, oldest first.
+     */
+    static juce::String decode(const juce::File& file, double last_seconds)
+    {
+        juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly, false);
+        const juce::uint8* data = static_cast<const juce::uint8*>(mapped.getData());
+        if (data == nullptr || mapped.getSize() < sizeof(Header))
+            return "Not a flight recorder file";
+        Header header;
+        std::memcpy(&header, data, sizeof(Header));
+        if (std::memcmp(header.magic, fileMagic, sizeof(header.magic)) != 0 || mapped.getSize() < getFileSize(header.numLanes, header.eventsPerLane))
+            return "Not a flight recorder file";
+
+        std::map<juce::uint32, juce::String> tagNames;
+        const TagEntry* entries = getTagTable(const_cast<juce::uint8*>(data));
+        for (juce::uint32 entry = 0; entry < numTagEntries; ++entry)
+        {
+            const juce::uint32 id = entries[entry].id.load(std::memory_order_relaxed);
+            if (id != 0)
+                tagNames[id] = juce::String::fromUTF8(entries[entry].name, static_cast<int>(strnlen(entries[entry].name, sizeof(entries[entry].name))));
+        }
+
+        std::vector<Event> events;
+        for (juce::uint32 lane = 0; lane < header.numLanes; ++lane)
+        {
+            const juce::uint8* laneData = getLane(const_cast<juce::uint8*>(data), lane, header.eventsPerLane);
+            juce::uint64 written = 0;
+            std::memcpy(&written, laneData, sizeof(written));
+            const juce::uint64 first = written > header.eventsPerLane ? written - header.eventsPerLane : 0;
+            for (juce::uint64 index = first; index < written; ++index)
+            {
+                Event event;
+                std::memcpy(&event, laneData + laneHeaderSize + (index % header.eventsPerLane) * sizeof(Event), sizeof(Event));
+                if (event.sequence == static_cast<juce::uint32>(index + 1)) // Skip slots overwritten or torn mid-write
+                    events.push_back(event);
+            }
+        }
+        if (events.empty())
+            return {};
+
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.ticks < b.ticks; });
+        const double ticksPerMs = static_cast<double>(header.ticksPerSecond) / 1000.0;
+        const juce::int64 lastTicks = events.back().ticks;
+        const juce::int64 firstTicks = lastTicks - static_cast<juce::int64>(last_seconds * 1000.0 * ticksPerMs);
+
+        juce::String timeline;
+        for (const Event& event : events)
+        {
+            if (event.ticks < firstTicks)
+                continue;
+            const double msBeforeEnd = static_cast<double>(lastTicks - event.ticks) / ticksPerMs;
+            timeline << "-" << juce::String(msBeforeEnd, 3) << " ms  " << getLaneName(event.lane) << "  " << getEventName(event.type)
+                     << "  job " << juce::String(event.jobId) << "  priority " << juce::String(static_cast<int>(event.priority));
+            const auto tagName = tagNames.find(event.tag);
+            if (tagName != tagNames.end())
+                timeline << "  " << tagName->second;
+            timeline << "\n";
+        }
+        return timeline;
+    }
+
+private:
+    struct Header
+    {
+        char magic[8] {};
+        juce::uint32 numLanes { 0 };
+        juce::uint32 eventsPerLane { 0 };
+        juce::int64 ticksPerSecond { 0 };
+        juce::uint8 reserved[40] {};
+    };
+    struct Event
+    {
+        juce::int64 ticks;
+        juce::uint64 jobId;
+        juce::uint32 sequence;
+        juce::uint32 tag;
+        juce::uint8 type;
+        juce::int8 priority;
+        juce::uint16 lane;
+        juce::uint32 reserved;
+    };
+    struct TagEntry
+    {
+        std::atomic<juce::uint32> id;
+        char name[60];
+    };
+    static_assert(sizeof(Header) == 64, "Flight recorder header layout changed");
+    static_assert(sizeof(Event) == 32, "Flight recorder event layout changed");
+    static_assert(sizeof(TagEntry) == 64, "Flight recorder tag layout changed");
+
+    static constexpr const char* fileMagic = "JJSFREC2";
+    static constexpr size_t laneHeaderSize = 64; // Write index, padded to its own cache line
+    static constexpr juce::uint32 numTagEntries = 256;
+
+    static size_t getLaneSize(juce::uint32 events_per_lane) { return laneHeaderSize + sizeof(Event) * events_per_lane; }
+    static size_t getFileSize(juce::uint32 num_lanes, juce::uint32 events_per_lane) { return sizeof(Header) + sizeof(TagEntry) * numTagEntries + getLaneSize(events_per_lane) * num_lanes; }
+    static TagEntry* getTagTable(void* data) { return reinterpret_cast<TagEntry*>(static_cast<juce::uint8*>(data) + sizeof(Header)); }
+    static juce::uint8* getLane(void* data, juce::uint32 lane, juce::uint32 events_per_lane)
+    {
+        return static_cast<juce::uint8*>(data) + sizeof(Header) + sizeof(TagEntry) * numTagEntries + getLaneSize(events_per_lane) * lane;
+    }
+    static juce::String getLaneName(int lane)
+    {
+        switch (lane)
+        {
+            case ProducerLane: return "producer";
+            case SchedulerLane: return "scheduler";
+            case MessageThreadLane: return "message";
+            default: return "worker " + juce::String(lane - FirstWorkerLane);
+        }
+    }
+    static juce::String getEventName(int type)
+    {
+        switch (type)
+        {
+            case Push: return "push";
+            case Dispatch: return "dispatch";
+            case Start: return "start";
+            case Finish: return "finish";
+            case Callback: return "callback";
+            case Drop: return "drop";
+            default: return "unknown";
+        }
+    }
+
+    const juce::uint32 numLanes;
+    const juce::uint32 eventsPerLane;
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+};
+
+} // JJS
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    InstrumentedLock.h
+    Created: 18 Oct 2026 3:58:02pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "LatencyHistogram.h"
+
+namespace JJS
+{
+
+/**
+ Contention figures for every lock created with the same site name. Wait times cover contended acquisitions only,
+ percentiles are histogram bucket upper edges and the max is exact. The full distribution is LockSite::get(site).getWaitTime().
+ */
+struct LockStatistics
+{
+    juce::String site;
+    juce::uint64 acquisitions { 0 };
+    juce::uint64 contendedAcquisitions { 0 };
+    double meanWaitMicroseconds { 0 };
+    double p50WaitMicroseconds { 0 };
+    double p99WaitMicroseconds { 0 };
+    double p999WaitMicroseconds { 0 };
+    double maxWaitMicroseconds { 0 };
+};
+
+/**
+ Shared counters for one lock site. Sites live for the whole process so locks can keep a reference to theirs.
+ */
+class LockSite
+{
+public:
+    explicit LockSite(const char* site_name) : name(site_name) { }
+
+    static LockSite& get(const char* site_name)
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto& site : registry.sites)
+            if (std::strcmp(site->name, site_name) == 0)
+                return *site;
+        registry.sites.push_back(std::make_unique<LockSite>(site_name));
+        return *registry.sites.back();
+    }
+    static std::vector<LockStatistics> getAllStatistics()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        std::vector<LockStatistics> statistics;
+        for (auto& site : registry.sites)
+            statistics.push_back(site->getStatistics());
+        return statistics;
+    }
+    static void resetAllStatistics()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto& site : registry.sites)
+        {
+            site->acquisitions.store(0);
+            site->contendedAcquisitions.store(0);
+            site->waitTime.reset();
+        }
+    }
+
+    void recordAcquisition() { acquisitions.fetch_add(1, std::memory_order_relaxed); }
+    void recordContendedAcquisition(juce::int64 wait_ticks)
+    {
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+        contendedAcquisitions.fetch_add(1, std::memory_order_relaxed);
+        waitTime.addTicks(wait_ticks);
+    }
+    LockStatistics getStatistics() const
+    {
+        LockStatistics statistics;
+        statistics.site = name;
+        statistics.acquisitions = acquisitions.load();
+        statistics.contendedAcquisitions = contendedAcquisitions.load();
+        statistics.meanWaitMicroseconds = waitTime.getMeanMicroseconds();
+        statistics.p50WaitMicroseconds = waitTime.getPercentile(50.0);
+        statistics.p99WaitMicroseconds = waitTime.getPercentile(99.0);
+        statistics.p999WaitMicroseconds = waitTime.getPercentile(99.9);
+        statistics.maxWaitMicroseconds = waitTime.getMaxMicroseconds();
+        return statistics;
+    }
+    /** Wait time of every contended acquisition at this site. */
+    const LatencyHistogram& getWaitTime() const { return waitTime; }
+
+private:
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<LockSite>> sites;
+    };
+    static Registry& getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    const char* name;
+    std::atomic<juce::uint64> acquisitions { 0 };
+    std::atomic<juce::uint64> contendedAcquisitions { 0 };
+    LatencyHistogram waitTime;
+};
+
+#if JJS_INSTRUMENT_LOCKS
+/**
+ juce::CriticalSection that counts acquisitions, contended acquisitions and wait time for its site.
+ An uncontended enter() costs one extra tryEnter() and a relaxed increment.
+ */
+class CriticalSection
+{
+public:
+    explicit CriticalSection(const char* site_name = "Unnamed Lock") : site(LockSite::get(site_name)) { }
+
+    void enter() const noexcept
+    {
+        if (lock.tryEnter())
+        {
+            site.recordAcquisition();
+            return;
+        }
+        const juce::int64 start = juce::Time::getHighResolutionTicks();
+        lock.enter();
+        site.recordContendedAcquisition(juce::Time::getHighResolutionTicks() - start);
+    }
+    bool tryEnter() const noexcept
+    {
+        if (!lock.tryEnter())
+            return false;
+        site.recordAcquisition();
+        return true;
+    }
+    void exit() const noexcept { lock.exit(); }
+
+    using ScopedLockType = juce::GenericScopedLock<CriticalSection>;
+
+private:
+    juce::CriticalSection lock;
+    LockSite& site;
+};
+#else
+/**
+ Plain juce::CriticalSection, the site name is only used when JJS_INSTRUMENT_LOCKS is set.
+ */
+class CriticalSection : public juce::CriticalSection
+{
+public:
+    explicit CriticalSection(const char* = nullptr) { }
+    using ScopedLockType = juce::GenericScopedLock<CriticalSection>;
+};
+#endif
+
+using ScopedLock = juce::GenericScopedLock<CriticalSection>;
+
+/**
+ Contention figures for every instrumented lock site, empty unless JJS_INSTRUMENT_LOCKS is set.
+ */
+inline std::vector<LockStatistics> getLockStatistics() { return LockSite::getAllStatistics(); }
+inline void resetLockStatistics() { LockSite::resetAllStatistics(); }
+
+} // JJS
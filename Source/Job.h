@@ -14,22 +14,122 @@
 namespace JJS
 {
 using namespace ScopeTrackedFunctions;
+class OrderedChannel;
+class CompletionExecutor;
+
+/**
+ Refers to a pushed Job, so it can be reprioritized while it is still queued.
+ */
+struct JobHandle
+{
+    juce::uint64 id { 0 };
+    bool isValid() const { return id != 0; }
+};
+
+/**
+ Compile time name and category for a job, used by every diagnostic to group jobs by type.
+ Declare tags constexpr, so the compiler computes the id and tagging a job costs three stores and no allocation:
+     static constexpr JJS::JobTag thumbnailTag { "Thumbnail", "Browser" };
+     job->setTag(thumbnailTag);
+ */
+struct JobTag
+{
+    constexpr JobTag(const char* tag_name, const char* tag_category = nullptr)
+    : name(tag_name), category(tag_category), id(makeId(tag_name, tag_category)) { }
+    
+    const char* name;
+    const char* category;
+    juce::uint32 id; // FNV-1a of category and name, never 0
+    
+private:
+    static constexpr juce::uint32 hash(const char* text, juce::uint32 seed)
+    {
+        juce::uint32 result = seed;
+        for (; text != nullptr && *text != 0; ++text)
+            result = (result ^ static_cast<juce::uint8>(*text)) * 16777619u;
+        return result;
+    }
+    static constexpr juce::uint32 makeId(const char* tag_name, const char* tag_category)
+    {
+        const juce::uint32 result = hash(tag_name, hash("/", hash(tag_category, 2166136261u)));
+        return result != 0 ? result : 1;
+    }
+};
 
 class Job
 {
 public:
     enum Priority
     {
-        Normal,
-        Urgent
+        Background = -1, // Only dispatched when no other priority is waiting, see shouldYield()
+        Normal = 0,
+        Urgent = 1
     };
+    static constexpr size_t numPriorities = static_cast<size_t>(Priority::Urgent - Priority::Background + 1);
+    /** Array index of a priority, from 0 for Background to numPriorities - 1 for Urgent. */
+    static constexpr size_t getPriorityIndex(Priority job_priority) { return static_cast<size_t>(job_priority - Priority::Background); }
+    static constexpr Priority getPriorityFromIndex(size_t priority_index) { return static_cast<Priority>(static_cast<int>(priority_index) + Priority::Background); }
     
     Job(std::function<void()>&& job_action, std::function<void()>&& job_callback = std::function<void()>(), Priority job_priority = Priority::Normal)
     : action(std::move(job_action)), callback(std::move(job_callback)), priority(job_priority) {}
     virtual ~Job() { }
+    /**
+     Optional cheap evaluator called by the scheduler thread when choosing among the oldest queued jobs of the same priority. Higher scores run sooner, jobs without one score 0 and keep their queue order. It must be safe to call from the scheduler thread, e.g. by only reading atomics.
+     */
+    void setPriorityFunction(std::function<float()>&& priority_function) { priorityFunction = std::move(priority_function); }
+    /**
+     Called on the message thread instead of the callbacks if the JobSystem sheds this job before it ran.
+     */
+    void setDroppedCallback(std::function<void()>&& dropped_callback) { droppedCallback = std::move(dropped_callback); }
+    /**
+     Name and category used by traces, statistics, the sampler and worker thread names. See JobTag.
+     */
+    void setTag(const JobTag& job_tag)
+    {
+        name = job_tag.name;
+        category = job_tag.category;
+        tagId = job_tag.id;
+    }
+    /**
+     Shorthand for an uncategorised tag. Must be a string literal, or otherwise outlive the JobSystem.
+     */
+    void setName(const char* static_name) { setTag(JobTag(static_name)); }
+    const char* getName() const { return name != nullptr ? name : "Unnamed Job"; }
+    const char* getCategory() const { return category; }
+    /**
+     Tags the job with the component, plugin instance or FunctionScope that submitted it, so JobSystem::getOwnerStatistics() can attribute its CPU time and queue wait. The name must be a string literal, or otherwise outlive the JobSystem.
+     SharedJobSystemPointer::pushJob() tags jobs with the pointer automatically, and JobSystem::pushJob() falls back to the callbacks container.
+     */
+    void setOwner(const void* owner_tag, const char* owner_name = nullptr) { owner = owner_tag; ownerName = owner_name; }
+    template <typename fn>
+    void setOwner(const FunctionScope<fn>& owner_scope, const char* owner_name = nullptr) { setOwner(static_cast<const void*>(&owner_scope), owner_name); }
+    const void* getOwner() const { return owner; }
+    /**
+     How long the job occupies a worker when run by a Simulation. Ignored otherwise.
+     */
+    void setSimulatedDuration(double duration_ms) { simulatedDurationMs = duration_ms; }
+    /**
+     Once the job has run for longer than this, the JobSystem watchdog reports it and shouldAbort() starts returning true. Zero disables the limit.
+     */
+    void setTimeLimit(double time_limit_ms) { timeLimitMs = time_limit_ms; }
+    /**
+     Delivers this job's callbacks in push order with the other jobs of the channel, see OrderedChannel. The channel must come from the JobSystem the job is pushed to.
+     */
+    void setOrderedChannel(OrderedChannel& ordered_channel) { orderedChannel = &ordered_channel; }
+    /**
+     Runs this job's callbacks, or dropped callbacks, on the given executor instead of the message thread. Null restores the message thread.
+     Ordered channel jobs always complete on the message thread. The executor must outlive the job.
+     */
+    void setCompletionExecutor(CompletionExecutor* completion_executor) { completionExecutor = completion_executor; }
     virtual void jobSetup() { }
     virtual void jobAction() { };
     virtual void jobCallback() { };
+    virtual void jobDropped() { };
+    /**
+     Approximate bytes held by this job while it is queued or running, summed by JobSystem::getMemoryUsage(). Called once, when the job is pushed.
+     The default only counts the Job itself. Override to add the size of your subclass and state captured on the heap, e.g. sample buffers or the captures of large lambdas.
+     */
+    virtual size_t getMemoryUsage() const { return sizeof(Job); }
     
     bool operator<(const Job& other) const
     {
@@ -40,7 +140,17 @@ public:
 protected:
     Job(Job::Priority job_priority = Job::Priority::Normal) : priority(job_priority) { }
     
-    bool shouldAbort() { if (shouldAbortFn) return shouldAbortFn(); return false; }
+    bool shouldAbort()
+    {
+        if (timedOut != nullptr && timedOut->load())
+            return true;
+        if (shouldAbortFn) return shouldAbortFn();
+        return false;
+    }
+    /**
+     Background jobs should poll this like shouldAbort() and return early when it is true, as it means real work is waiting for a thread. Speculative work can simply be pushed again later.
+     */
+    bool shouldYield() { if (shouldAbort()) return true; return priority == Priority::Background && shouldYieldFn && shouldYieldFn(); }
     void executeUpdate(float progress)
     {
         if (sendUpdateFn && scopedProgressCallbacks)
@@ -51,6 +161,7 @@ protected:
     }
 private:
     friend class JobSystem;
+    friend class JobQueue;
     void executeAction()
     {
         executeUpdate(0);
@@ -59,24 +170,50 @@ private:
     };
     void executeCallback()
     {
+        if (dropped)
+        {
+            jobDropped();
+            if (droppedCallback) droppedCallback();
+            return;
+        }
         jobCallback();
         if(callback) callback();
         if (scopedCallbacks) scopedCallbacks->triggerFunctions();
     };
-    void linkSystem(std::function<bool()>&& shouldAbortFN, ScopedFunctionContainer<void()>* callbacks, ScopedFunctionContainer<void(float)>* progressCallbacks, std::function<void(std::function<void()>&&)>&& sendUpdateFN)
+    void linkSystem(std::function<bool()>&& shouldAbortFN, std::function<bool()>&& shouldYieldFN, ScopedFunctionContainer<void()>* callbacks, ScopedFunctionContainer<void(float)>* progressCallbacks, std::function<void(std::function<void()>&&)>&& sendUpdateFN)
     {
         shouldAbortFn = shouldAbortFN;
+        shouldYieldFn = std::move(shouldYieldFN);
         scopedCallbacks = callbacks;
         scopedProgressCallbacks = progressCallbacks;
         sendUpdateFn = std::move(sendUpdateFN);
     }
     std::function<void()> action;
     std::function<void()> callback;
+    std::function<void()> droppedCallback;
     
     Priority priority { Priority::Normal };
+    std::function<float()> priorityFunction;
     long queuePosition { 0 };
+    juce::uint64 id { 0 };
+    double queuedTime { 0 };
+    double finishedTime { 0 };
+    bool dropped { false };
+    const char* name { nullptr };
+    const char* category { nullptr };
+    juce::uint32 tagId { 0 };
+    const void* owner { nullptr };
+    const char* ownerName { nullptr };
+    double timeLimitMs { 0 };
+    double simulatedDurationMs { 0 };
+    size_t accountedBytes { 0 };
+    OrderedChannel* orderedChannel { nullptr };
+    juce::uint64 orderedSequence { 0 };
+    CompletionExecutor* completionExecutor { nullptr };
+    std::atomic<bool>* timedOut { nullptr };
     
     std::function<bool()> shouldAbortFn;
+    std::function<bool()> shouldYieldFn;
     std::function<void(std::function<void()>&&)> sendUpdateFn;
     ScopedFunctionContainer<void()>* scopedCallbacks { nullptr };
     ScopedFunctionContainer<void(float)>* scopedProgressCallbacks { nullptr };
@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    JobQueue.h
+    Created: 18 Oct 2026 1:12:30pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Job.h"
+
+namespace JJS
+{
+
+/**
+ Queued jobs bucketed by priority, each bucket ordered by queue position.
+ Only touched by the scheduler thread. Jobs can be moved between buckets by id without re-queuing them.
+ */
+class JobQueue
+{
+public:
+    JobQueue() = default;
+    ~JobQueue()
+    {
+        for (auto& bucket : buckets)
+            for (auto& entry : bucket)
+                delete entry.second;
+    }
+    void pushJob(std::unique_ptr<Job>&& job)
+    {
+        Job* rawJob = job.release();
+        buckets[Job::getPriorityIndex(rawJob->priority)].emplace(rawJob->queuePosition, rawJob);
+        index.emplace(rawJob->id, rawJob);
+    }
+    /**
+     Pops from the highest priority bucket. The first candidate_window jobs of that bucket are scored with their priority function, and the best scoring one wins (ties go to the oldest).
+     */
+    std::unique_ptr<Job> popJob(int candidate_window = 1)
+    {
+        for (size_t priority = Job::numPriorities; priority-- > 0;)
+        {
+            auto& bucket = buckets[priority];
+            if (bucket.empty())
+                continue;
+            auto best = bucket.begin();
+            if (candidate_window > 1)
+            {
+                float bestScore = score(*best->second);
+                auto candidate = std::next(best);
+                for (int i = 1; i < candidate_window && candidate != bucket.end(); ++i, ++candidate)
+                {
+                    const float candidateScore = score(*candidate->second);
+                    if (candidateScore > bestScore)
+                    {
+                        bestScore = candidateScore;
+                        best = candidate;
+                    }
+                }
+            }
+            std::unique_ptr<Job> job(best->second);
+            bucket.erase(best);
+            index.erase(job->id);
+            return job;
+        }
+        return nullptr;
+    }
+    /**
+     Moves a queued job to another priority bucket, keeping its original queue position. Returns false if the job is no longer queued.
+     */
+    bool setPriority(juce::uint64 job_id, Job::Priority priority)
+    {
+        auto it = index.find(job_id);
+        if (it == index.end())
+            return false;
+        Job* job = it->second;
+        if (job->priority == priority)
+            return true;
+        auto node = buckets[Job::getPriorityIndex(job->priority)].extract(job->queuePosition);
+        job->priority = priority;
+        buckets[Job::getPriorityIndex(priority)].insert(std::move(node));
+        return true;
+    }
+    /**
+     Pops the oldest job of a priority if that bucket holds more than max_depth jobs, or if it was queued before oldest_allowed_time. Zero limits are ignored.
+     */
+    std::unique_ptr<Job> popStaleJob(Job::Priority priority, size_t max_depth, double oldest_allowed_time)
+    {
+        auto& bucket = buckets[Job::getPriorityIndex(priority)];
+        if (bucket.empty())
+            return nullptr;
+        Job* oldest = bucket.begin()->second;
+        const bool tooDeep = max_depth > 0 && bucket.size() > max_depth;
+        const bool tooOld = oldest_allowed_time > 0 && oldest->queuedTime < oldest_allowed_time;
+        if (!tooDeep && !tooOld)
+            return nullptr;
+        std::unique_ptr<Job> job(oldest);
+        bucket.erase(bucket.begin());
+        index.erase(job->id);
+        return job;
+    }
+    /** Returns the priority of the job that popJob() would return. Queue must not be empty. */
+    Job::Priority getHighestPriority() const
+    {
+        for (size_t priority = Job::numPriorities - 1; priority > 0; --priority)
+            if (!buckets[priority].empty())
+                return Job::getPriorityFromIndex(priority);
+        return Job::Priority::Background;
+    }
+    /** Visits up to max_jobs queued jobs, highest priority first and oldest first within a priority. */
+    template <typename Visitor>
+    void forEachJob(Visitor&& visitor, size_t max_jobs = std::numeric_limits<size_t>::max()) const
+    {
+        for (size_t priority = Job::numPriorities; priority-- > 0;)
+        {
+            for (const auto& entry : buckets[priority])
+            {
+                if (max_jobs-- == 0)
+                    return;
+                visitor(static_cast<const Job&>(*entry.second));
+            }
+        }
+    }
+    bool empty() const { return index.empty(); }
+    size_t size() const { return index.size(); }
+    size_t size(Job::Priority priority) const { return buckets[Job::getPriorityIndex(priority)].size(); }
+    /** The job of a priority that was pushed first, or nullptr if none is queued. */
+    const Job* getOldestJob(Job::Priority priority) const
+    {
+        const auto& bucket = buckets[Job::getPriorityIndex(priority)];
+        return bucket.empty() ? nullptr : bucket.begin()->second;
+    }
+    /**
+     Approximate bytes held by the bucket and index nodes, not counting the jobs themselves.
+     */
+    size_t getMemoryUsage() const
+    {
+        constexpr size_t bucketNodeSize = sizeof(std::map<long, Job*>::value_type) + 4 * sizeof(void*); // Three links and a colour, padded
+        constexpr size_t indexNodeSize = sizeof(std::unordered_map<juce::uint64, Job*>::value_type) + sizeof(void*);
+        return sizeof(*this) + index.size() * (bucketNodeSize + indexNodeSize) + index.bucket_count() * sizeof(void*);
+    }
+private:
+    static float score(const Job& job) { return job.priorityFunction ? job.priorityFunction() : 0.0f; }
+    
+    std::array<std::map<long, Job*>, Job::numPriorities> buckets;
+    std::unordered_map<juce::uint64, Job*> index;
+};
+
+} // JJS
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    JobSampler.h
+    Created: 18 Oct 2026 5:24:10pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "JobSystem.h"
+
+namespace JJS
+{
+
+/**
+ Low frequency sampling profiler. Periodically reads which named job each worker is running and counts the samples, so the busiest job types show up without tracing every job.
+ The output is in folded stack format, ready for flamegraph.pl or speedscope.
+
+ Usage:
+ 1. Create a JobSampler for a JobSystem that outlives it, it starts sampling right away.
+ 2. Tag your jobs with Job::setTag(), categories become their own frame above the job name.
+ 3. Write getFoldedStacks() to a file and render it.
+ */
+class JobSampler : juce::Thread
+{
+public:
+    JobSampler(const JobSystem& job_system, int samples_per_second = 100)
+    : juce::Thread("JJS Job Sampler"), jobSystem(job_system), intervalMs(juce::jmax(1, 1000 / juce::jmax(1, samples_per_second)))
+    {
+        startThread(juce::Thread::Priority::low);
+    }
+    ~JobSampler() override { stopThread(1000); }
+
+    /**
+     One line per stack: "JJS;worker 2;Audio;Thumbnail 153", the category frame is left out for jobs without one. Idle samples are included so the graph shows how busy the pool is. Pass false to merge all workers.
+     */
+    juce::String getFoldedStacks(bool split_by_worker = true) const
+    {
+        std::map<juce::String, juce::uint64> stacks;
+        {
+            ScopedLock lock(criticalSection);
+            for (const auto& entry : samples)
+            {
+                juce::String stack("JJS");
+                if (split_by_worker)
+                    stack << ";worker " << juce::String(std::get<0>(entry.first));
+                const char* category = std::get<1>(entry.first);
+                const char* name = std::get<2>(entry.first);
+                if (category != nullptr)
+                    stack << ";" << category;
+                stack << ";" << (name != nullptr ? juce::String(name) : juce::String("idle"));
+                stacks[stack] += entry.second;
+            }
+        }
+        juce::String folded;
+        for (const auto& stack : stacks)
+            folded << stack.first << " " << juce::String(stack.second) << "\n";
+        return folded;
+    }
+    juce::uint64 getNumSamples() const { return numSamples.load(); }
+    void reset()
+    {
+        ScopedLock lock(criticalSection);
+        samples.clear();
+        numSamples.store(0);
+    }
+
+private:
+    void run() override
+    {
+        std::vector<const char*> currentJobs;
+        std::vector<const char*> currentCategories;
+        while (!threadShouldExit())
+        {
+            jobSystem.getCurrentJobNames(currentJobs, &currentCategories);
+            {
+                ScopedLock lock(criticalSection);
+                for (size_t worker = 0; worker < currentJobs.size(); ++worker)
+                    samples[{ static_cast<int>(worker), currentCategories[worker], currentJobs[worker] }]++;
+            }
+            numSamples++;
+            wait(intervalMs);
+        }
+    }
+
+    const JobSystem& jobSystem;
+    const int intervalMs;
+    std::map<std::tuple<int, const char*, const char*>, juce::uint64> samples; // Worker, category, name
+    std::atomic<juce::uint64> numSamples { 0 };
+    CriticalSection criticalSection { "JobSampler" };
+};
+
+} // JJS
@@ -11,57 +11,195 @@
 #pragma once
 #include <JuceHeader.h>
 #include "LockFreeFifo.h"
-#include "Job.h"
+#include "JobQueue.h"
+#include "FlightRecorder.h"
+#include "Probes.h"
+#include "WorkerStatistics.h"
+#include "OrderedChannel.h"
+#include "CompletionExecutor.h"
 
 namespace JJS
 {
 
-class JobQueue : public std::priority_queue<Job*>
+/**
+ Replaces the scheduler thread, message thread timer, thread pool and clock of a JobSystem with a deterministic virtual time executor, see Simulation.
+ */
+class SimulationDriver
 {
 public:
-    ~JobQueue()
-    {
-        std::unique_ptr<Job> job = popJob();
-        while(job != nullptr)
-        {
-            job.reset();
-            job = popJob();
-        }
-    };
-    void pushJob(std::unique_ptr<Job>&& job)
-    {
-        push(job.release());
-    }
-    std::unique_ptr<Job> popJob()
-    {
-        if(empty())
-            return nullptr;
-        
-        std::unique_ptr<Job> job(top());
-        pop();
-        return job;
-    }
+    virtual ~SimulationDriver() = default;
+    virtual double getTime() const = 0;
+    virtual void startJob(std::function<void()>&& work, double duration_ms) = 0;
+    virtual int getNumRunningJobs() const = 0;
+    virtual void cancelAllJobs() = 0;
 };
 
 template<typename JobSystem>
 class SharedJobSystemPointer : public juce::SharedResourcePointer<JobSystem>
 {
 public:
+    /**
+     Pushes to the shared JobSystem, tagging the job with this pointer as its owner unless it already has one.
+     */
+    template <typename... Args>
+    JobHandle pushJob(std::unique_ptr<Job> job, Args&&... args)
+    {
+        if (job->getOwner() == nullptr)
+            job->setOwner(this, ownerName);
+        return this->get().pushJob(std::move(job), std::forward<Args>(args)...);
+    }
+    /** Name reported by JobSystem::getOwnerStatistics(). Must be a string literal, or otherwise outlive the JobSystem. */
+    void setOwnerName(const char* owner_name) { ownerName = owner_name; }
+    
     FunctionScope<void()> callbackScope;
     FunctionScope<void(float)> progressCallbackScope;
+private:
+    const char* ownerName { nullptr };
 };
 
 class JobSystem : juce::Thread, juce::Timer
 {
 public:
+    /**
+     Load shedding limits for one priority. Zero means unlimited.
+     */
+    struct QueueLimits
+    {
+        double maxQueueAgeMs { 0 };
+        int maxDepth { 0 };
+    };
+    
+    /**
+     How long the message thread spends in each callback drain, which is what a UI frame pays for JobSystem callbacks.
+     Times are in microseconds and only include ticks that had something to deliver. Percentiles are within 12.5%, the max and total are exact.
+     */
+    struct CallbackDrainStatistics
+    {
+        juce::uint64 numDrains { 0 };
+        juce::uint64 numIdleDrains { 0 };
+        juce::uint64 progressCallbacks { 0 };
+        juce::uint64 completionCallbacks { 0 };
+        int maxCallbacksPerDrain { 0 };
+        double meanMicroseconds { 0 };
+        double p50Microseconds { 0 };
+        double p95Microseconds { 0 };
+        double p99Microseconds { 0 };
+        double maxMicroseconds { 0 };
+        double totalMicroseconds { 0 }; // Sum of every drain, a frame loop can difference two reads to get its own share
+        double p99ProgressMicroseconds { 0 };
+        double p99CompletionMicroseconds { 0 };
+    };
+    
+    /**
+     Where the time between pushJob() and the callback goes, for one priority. Jobs are counted under the priority they were dispatched with.
+     */
+    struct LatencyStatistics
+    {
+        LatencyHistogram::Summary queueWait;      // Push to start on a worker
+        LatencyHistogram::Summary runTime;        // Start to finish on the worker
+        LatencyHistogram::Summary callbackDelay;  // Finish to callback on the message thread
+        LatencyHistogram::Summary endToEnd;       // Push to callback
+    };
+    
+    /**
+     What a queued or running job looks like in a QueueSnapshot. Names are the literals given to Job::setTag() and Job::setOwner().
+     */
+    struct JobInfo
+    {
+        juce::uint64 id { 0 };
+        const char* name { nullptr };
+        const char* category { nullptr };
+        Job::Priority priority { Job::Priority::Normal };
+        const void* owner { nullptr };
+        const char* ownerName { nullptr };
+        double ageMs { 0 };     // Since pushJob()
+        double runningMs { 0 }; // Since dispatch, 0 while queued
+        int worker { -1 };      // -1 while queued
+    };
+    
+    /**
+     Queued jobs in dispatch order, and running jobs by worker, as the scheduler saw them at one pass.
+     Only the first jobs up to the snapshot limit are listed in queued, the per-priority counts and ages cover every queued job.
+     */
+    struct QueueSnapshot
+    {
+        struct PriorityInfo
+        {
+            size_t numQueued { 0 };
+            double oldestAgeMs { 0 }; // Since pushJob(), 0 when none are queued
+        };
+        double time { 0 };
+        std::vector<JobInfo> queued;
+        std::vector<JobInfo> running;
+        std::array<PriorityInfo, Job::numPriorities> byPriority; // Indexed with Job::getPriorityIndex()
+        size_t numQueued { 0 };    // Every queued job, listed or not
+        int numUnsortedJobs { 0 }; // Pushed after the snapshot pass started
+    };
+    
+    /**
+     Latency objective for one priority, e.g. p99 queue wait under 5 ms, evaluated over a sliding window.
+     An objective is only breached once the lower edge of the percentile's histogram bucket is over the threshold, so it never fires on bucket rounding alone,
+     but a percentile up to 12.5% over the threshold can go unreported.
+     */
+    struct LatencyObjective
+    {
+        enum Metric
+        {
+            QueueWait, // Push to start on a worker
+            EndToEnd,  // Push to callback on the message thread
+            numMetrics
+        };
+        Metric metric { QueueWait };
+        double percentile { 99.0 };
+        double thresholdMs { 5.0 };
+        double windowMs { 1000.0 };
+        int minSamples { 20 }; // Windows with fewer samples are not judged, and end a breach
+    };
+    
+    /**
+     Passed to the objective callback when an objective starts or stops being breached.
+     */
+    struct ObjectiveEvent
+    {
+        Job::Priority priority { Job::Priority::Normal };
+        LatencyObjective objective;
+        double observedMs { 0 }; // Lower bound of the percentile, as judged against the threshold
+        juce::uint64 numSamples { 0 };
+        bool breached { false }; // False when the objective recovered
+        bool insufficientSamples { false }; // The breach ended because the window fell below minSamples, not because latency recovered
+    };
+    
+    /**
+     Passed to the watchdog callback when a running job exceeds its time limit.
+     */
+    struct OverdueJobInfo
+    {
+        juce::uint64 jobId { 0 };
+        const char* name { nullptr };
+        const char* category { nullptr };
+        Job::Priority priority { Job::Priority::Normal };
+        int worker { 0 };
+        double runningMs { 0 };
+        double timeLimitMs { 0 };
+    };
+    
     /**
      Use Callbacks: This will run a jobs callback function on the main message thread, through a timer popping a FIFO. The jobs will lock as they are pushing their callbacks to the FIFO on job completion, so only enable callbacks if you need them!
+     Spare Workers: Extra pool threads that only take jobs while the watchdog holds hung jobs, so a runaway job doesn't cost the system a worker.
      */
-    JobSystem(const juce::String& scheduler_thread_name, int num_concurrent_jobs) : juce::Thread(scheduler_thread_name), threadPool(num_concurrent_jobs)
+    JobSystem(const juce::String& scheduler_thread_name, int num_concurrent_jobs, int num_spare_workers = 0)
+    : juce::Thread(scheduler_thread_name), numConcurrentJobs(num_concurrent_jobs), numSpareWorkers(num_spare_workers), workerSlots(static_cast<size_t>(num_concurrent_jobs + num_spare_workers)), threadPool(std::make_unique<juce::ThreadPool>(num_concurrent_jobs + num_spare_workers))
     {
         startThread(juce::Thread::Priority::highest);
         startTimer(2);
     }
+    /**
+     Simulation Mode: No threads or timers are started, the driver runs the scheduler, the callbacks and every job on its own virtual clock. See Simulation.
+     */
+    JobSystem(SimulationDriver& simulation_driver, int num_concurrent_jobs, int num_spare_workers = 0)
+    : juce::Thread("JJS Simulation"), simulation(&simulation_driver), numConcurrentJobs(num_concurrent_jobs), numSpareWorkers(num_spare_workers), workerSlots(static_cast<size_t>(num_concurrent_jobs + num_spare_workers))
+    {
+    }
     ~JobSystem() { stopSystem(); }
     
     /**
@@ -70,8 +208,21 @@ public:
     void flush()
     {
         abort.store(true);
-        threadPool.removeAllJobs(true, 1000);
-        finishedJobs.clear();
+        if (simulation != nullptr)
+            simulation->cancelAllJobs();
+        else
+            threadPool->removeAllJobs(true, 1000);
+        {
+            // Workers push under criticalSection, and the drain pops under consumerLock, so each side of the FIFO has one thread at a time
+            ScopedLock consumer(consumerLock);
+            ScopedLock lock(criticalSection);
+            while (finishedJobs.getNumItems() > 0)
+                discardFinishedJob(*finishedJobs.pop());
+            for (const std::shared_ptr<Job>& job : overflowFinishedJobs)
+                discardFinishedJob(*job);
+            overflowFinishedJobs.clear();
+            hasOverflowFinishedJobs.store(false);
+        }
         abort.store(false);
     }
     /**
@@ -85,20 +236,58 @@ public:
         abort.store(true);
     }
     
-    int size() { return threadPool.getNumThreads(); };
+    int size() { return numConcurrentJobs; };
     
-    void pushJob(std::unique_ptr<Job> job, ScopedFunctionContainer<void()>* callbacks = nullptr, ScopedFunctionContainer<void(float)>* progressCallbacks = nullptr)
+    JobHandle pushJob(std::unique_ptr<Job> job, ScopedFunctionContainer<void()>* callbacks = nullptr, ScopedFunctionContainer<void(float)>* progressCallbacks = nullptr)
     {
-        job->linkSystem([&](){ return abort.load(); }, callbacks, progressCallbacks, [&](std::function<void()>&& progressCallback)
+        job->linkSystem([&](){ return abort.load(); }, [&](){ return yieldBackground.load(); }, callbacks, progressCallbacks, [&](std::function<void()>&& progressCallback)
         {
-            juce::ScopedLock lock(criticalSection);
-            progressCallbackFIFO.push(std::move(progressCallback));
+            ScopedLock lock(criticalSection);
+            if (hasOverflowProgressCallbacks.load() || !progressCallbackFIFO.push(std::move(progressCallback)))
+            {
+                overflowProgressCallbacks.push_back(std::move(progressCallback));
+                hasOverflowProgressCallbacks.store(true);
+            }
         });
         job->jobSetup();
-        inputJobs.push(std::move(job));
+        // Untagged jobs are attributed to the container their callbacks go to, which is usually per component
+        if (job->getOwner() == nullptr && callbacks != nullptr)
+            job->setOwner(callbacks);
+        if (job->completionExecutor == nullptr && callbacks != nullptr && hasCallbackExecutors.load())
+        {
+            ScopedLock lock(executorLock);
+            auto executor = callbackExecutors.find(callbacks);
+            if (executor != callbackExecutors.end())
+                job->completionExecutor = executor->second;
+        }
+        job->id = ++jobIdCounter;
+        job->queuedTime = now();
+        job->accountedBytes = job->getMemoryUsage();
+        queuedJobBytes += job->accountedBytes;
+        if (job->orderedChannel != nullptr)
+            job->orderedSequence = job->orderedChannel->assignSequence();
+        recordEvent(FlightRecorder::ProducerLane, FlightRecorder::Push, *job);
+        JJS_PROBE(job__push, job->id, job->priority, inputJobs.getNumItems(), job->getName());
+        const JobHandle handle { job->id };
+        const bool isForeground = job->priority != Job::Priority::Background;
+        numPushedJobs++;
+        {
+            // Many threads push, and a full FIFO spills into the overflow rather than losing the job
+            ScopedLock lock(inputLock);
+            if (hasOverflowInputJobs.load() || !inputJobs.push(std::move(job)))
+            {
+                overflowInputJobs.push_back(std::move(job));
+                hasOverflowInputJobs.store(true);
+            }
+        }
+        
+        // Wake the scheduler so running Background jobs are told to yield without waiting a tick
+        if (isForeground && runningBackgroundJobs.load() > 0)
+            notify();
+        return handle;
     }
     
-    void pushJob(std::unique_ptr<Job> job, const juce::Identifier& callback_id, const juce::Identifier& progress_callback_id = juce::Identifier())
+    JobHandle pushJob(std::unique_ptr<Job> job, const juce::Identifier& callback_id, const juce::Identifier& progress_callback_id = juce::Identifier())
     {
         JJS::ScopedFunctionContainer<void()>* callbacks = nullptr;
         JJS::ScopedFunctionContainer<void(float)>* progressCallbacks = nullptr;
@@ -116,7 +305,350 @@ public:
             }
         }
 
-        pushJob(std::move(job), callbacks, progressCallbacks);
+        return pushJob(std::move(job), callbacks, progressCallbacks);
+    }
+    
+    /**
+     Changes the priority of a job that is still queued. Safe to call from any thread, the change is applied by the scheduler before it picks the next job. Jobs that already started are left alone.
+     */
+    void setPriority(JobHandle handle, Job::Priority priority)
+    {
+        if (!handle.isValid())
+            return;
+        ScopedLock lock(criticalSection);
+        pushPriorityChange(PriorityChange { handle.id, priority });
+    }
+    
+    /**
+     Changes the priority of many queued jobs at once, e.g. everything that scrolled into view.
+     */
+    void setPriority(const std::vector<JobHandle>& handles, Job::Priority priority)
+    {
+        ScopedLock lock(criticalSection);
+        for (const JobHandle& handle : handles)
+            if (handle.isValid())
+                pushPriorityChange(PriorityChange { handle.id, priority });
+    }
+    
+    /**
+     Number of oldest jobs in the top priority bucket whose priority functions are evaluated on each dispatch. 1 disables lazy priorities.
+     */
+    void setDispatchCandidateWindow(int num_candidates) { dispatchCandidateWindow.store(juce::jmax(1, num_candidates)); }
+    
+    /**
+     Limits how stale and how deep the queue of a priority may get. Under overload the oldest jobs past a limit are dropped, and their dropped callbacks run on the message thread instead of their callbacks.
+     */
+    void setQueueLimits(Job::Priority priority, QueueLimits limits)
+    {
+        maxQueueAgeMs[Job::getPriorityIndex(priority)].store(limits.maxQueueAgeMs);
+        maxQueueDepth[Job::getPriorityIndex(priority)].store(limits.maxDepth);
+    }
+    
+    juce::uint64 getNumDroppedJobs() const { return numDroppedJobs.load(); }
+    
+    /**
+     Makes a channel whose jobs deliver their callbacks in the order they were pushed, see OrderedChannel. It lives as long as the JobSystem.
+     reorder_capacity bounds how far the channel may run ahead of its oldest undelivered job, and so how many completions can wait in its reorder buffer.
+     */
+    OrderedChannel& createOrderedChannel(int reorder_capacity = 64)
+    {
+        ScopedLock lock(channelLock);
+        orderedChannels.push_back(std::make_unique<OrderedChannel>(reorder_capacity));
+        return *orderedChannels.back();
+    }
+    
+    /**
+     Lifetime job accounting. Every pushed job is eventually delivered (its callbacks, or its dropped callbacks if it was shed), flushed by flush() / stopSystem(), or still pending, so pushed == delivered + flushed + pending always holds.
+     */
+    struct JobCounters
+    {
+        juce::uint64 pushed { 0 };
+        juce::uint64 delivered { 0 };
+        juce::uint64 dropped { 0 };
+        juce::uint64 flushed { 0 };
+        juce::uint64 getPending() const { return pushed - delivered - flushed; }
+    };
+    JobCounters getJobCounters() const
+    {
+        JobCounters counters;
+        counters.flushed = numFlushedJobs.load();
+        counters.delivered = numDeliveredJobs.load();
+        counters.dropped = numDroppedJobs.load();
+        counters.pushed = numPushedJobs.load();
+        return counters;
+    }
+    
+    /**
+     Approximate bytes held by the JobSystem, split by where they live. Jobs are measured with Job::getMemoryUsage() when pushed.
+     */
+    struct MemoryUsage
+    {
+        size_t inputFifo { 0 };       // Producer FIFO and its overflow
+        size_t finishedFifo { 0 };    // Completion FIFO and its overflow
+        size_t progressFifo { 0 };
+        size_t priorityChangeFifo { 0 };
+        size_t priorityQueue { 0 };   // Scheduler bookkeeping, as of its last pass
+        size_t queuedJobs { 0 };      // Pushed, not yet running
+        size_t activeJobs { 0 };      // Running, or waiting for their callback
+        size_t callbacks { 0 };       // Containers made by addCallback() and addProgressCallback()
+        size_t diagnostics { 0 };     // Worker slots, latency histograms and objective windows
+        size_t flightRecorder { 0 };  // File backed
+        size_t getTotal() const
+        {
+            return inputFifo + finishedFifo + progressFifo + priorityChangeFifo + priorityQueue + queuedJobs + activeJobs + callbacks + diagnostics + flightRecorder;
+        }
+    };
+    /**
+     Call from the message thread, as it walks the callback containers.
+     */
+    MemoryUsage getMemoryUsage() const
+    {
+        MemoryUsage usage;
+        {
+            ScopedLock lock(inputLock);
+            usage.inputFifo = inputJobs.getMemoryUsage() + overflowInputJobs.capacity() * sizeof(std::unique_ptr<Job>);
+        }
+        {
+            ScopedLock lock(criticalSection);
+            usage.finishedFifo = finishedJobs.getMemoryUsage() + overflowFinishedJobs.capacity() * sizeof(std::shared_ptr<Job>);
+            usage.progressFifo = progressCallbackFIFO.getMemoryUsage();
+        }
+        usage.priorityChangeFifo = priorityChanges.getMemoryUsage();
+        usage.priorityQueue = priorityQueueBytes.load();
+        usage.queuedJobs = queuedJobBytes.load();
+        usage.activeJobs = activeJobBytes.load();
+        constexpr size_t mapNodeSize = sizeof(juce::Identifier) + sizeof(void*) * 5;
+        for (const auto& entry : callbackMap)
+            usage.callbacks += mapNodeSize + (entry.second != nullptr ? entry.second->getMemoryUsage() : 0);
+        for (const auto& entry : progressCallbackMap)
+            usage.callbacks += mapNodeSize + (entry.second != nullptr ? entry.second->getMemoryUsage() : 0);
+        usage.diagnostics = workerSlots.capacity() * sizeof(WorkerSlot) + sizeof(jobLatency) + sizeof(objectiveWindows);
+        if (const FlightRecorder* recorder = flightRecorder.load())
+            usage.flightRecorder = recorder->getMemoryUsage();
+        return usage;
+    }
+    
+    /**
+     Called on the scheduler thread once for every job that runs past its time limit. Keep it short, it stalls scheduling.
+     */
+    void setWatchdogCallback(std::function<void(const OverdueJobInfo&)>&& watchdog_callback)
+    {
+        ScopedLock lock(watchdogLock);
+        watchdogCallback = std::move(watchdog_callback);
+    }
+    
+    int getNumHungJobs() const { return numHungJobs.load(); }
+    
+    /**
+     Starts recording push, dispatch, start, finish, callback and drop events into a memory-mapped ring file, see FlightRecorder::decode(). Call once, before pushing jobs.
+     */
+    bool enableFlightRecorder(const juce::File& file, int events_per_lane = 4096)
+    {
+        if (flightRecorder.load() != nullptr)
+            return false;
+        ownedFlightRecorder = std::make_unique<FlightRecorder>(file, static_cast<int>(workerSlots.size()), events_per_lane);
+        if (!ownedFlightRecorder->isOpen())
+        {
+            ownedFlightRecorder.reset();
+            return false;
+        }
+        flightRecorder.store(ownedFlightRecorder.get());
+        return true;
+    }
+    
+    /**
+     Busy, idle and CPU time of every worker since the last resetStatistics(). Spare workers are included after the regular ones.
+     */
+    std::vector<WorkerUtilization> getWorkerUtilization() const
+    {
+        const double elapsedMs = juce::jmax(1.0, now() - statisticsStartTime.load());
+        std::vector<WorkerUtilization> utilization;
+        for (size_t i = 0; i < workerSlots.size(); ++i)
+        {
+            const WorkerSlot& slot = workerSlots[i];
+            WorkerUtilization worker;
+            worker.worker = static_cast<int>(i);
+            worker.jobsRun = slot.jobsRun.load();
+            worker.busyMs = juce::jmin(elapsedMs, slot.busyMs.load());
+            worker.idleMs = elapsedMs - worker.busyMs;
+            worker.cpuMs = slot.cpuMs.load();
+            worker.utilization = worker.busyMs / elapsedMs;
+            worker.allocations = slot.allocations.load();
+            worker.allocatedBytes = slot.allocatedBytes.load();
+            utilization.push_back(worker);
+        }
+        return utilization;
+    }
+    
+    /**
+     Busy fraction of the regular workers since the last resetStatistics(), 0 - 1. Close to 1 means the pool is saturated.
+     */
+    double getPoolUtilization() const
+    {
+        double busyMs = 0;
+        for (int i = 0; i < numConcurrentJobs; ++i)
+            busyMs += workerSlots[static_cast<size_t>(i)].busyMs.load();
+        const double elapsedMs = juce::jmax(1.0, now() - statisticsStartTime.load());
+        return juce::jmin(1.0, busyMs / (elapsedMs * juce::jmax(1, numConcurrentJobs)));
+    }
+    
+    /**
+     Thread CPU time and wall time per job tag, see Job::setTag().
+     */
+    std::vector<JobTypeStatistics> getJobTypeStatistics() const
+    {
+        JobTypeTotals::Merged merged;
+        for (const WorkerSlot& slot : workerSlots)
+            slot.jobTypeTotals.mergeInto(merged);
+        return JobTypeTotals::getStatistics(merged);
+    }
+    
+    /**
+     Thread CPU time, job count and queue wait per owner, see Job::setOwner(). Untagged jobs are grouped under their callbacks container, or a null owner if they have none.
+     */
+    std::vector<OwnerStatistics> getOwnerStatistics() const
+    {
+        OwnerTotals::Merged merged;
+        for (const WorkerSlot& slot : workerSlots)
+            slot.ownerTotals.mergeInto(merged);
+        return OwnerTotals::getStatistics(merged);
+    }
+    
+    /**
+     Fills names with the job each worker is running right now, nullptr for idle workers. Unnamed jobs report "Unnamed Job". Used by JobSampler.
+     Pass categories to also get each running job's tag category, nullptr where it has none.
+     */
+    void getCurrentJobNames(std::vector<const char*>& names, std::vector<const char*>* categories = nullptr) const
+    {
+        names.resize(workerSlots.size());
+        if (categories != nullptr)
+            categories->resize(workerSlots.size());
+        for (size_t i = 0; i < workerSlots.size(); ++i)
+        {
+            const WorkerSlot& slot = workerSlots[i];
+            const bool busy = slot.busy.load(std::memory_order_relaxed);
+            const char* name = slot.jobName.load(std::memory_order_relaxed);
+            names[i] = busy ? (name != nullptr ? name : "Unnamed Job") : nullptr;
+            if (categories != nullptr)
+                (*categories)[i] = busy ? slot.jobCategory.load(std::memory_order_relaxed) : nullptr;
+        }
+    }
+    
+    /**
+     Renames each pool thread after the tag of the job it is running, so debuggers, profilers and top show what a worker is doing.
+     Threads are only renamed when the tag changes between jobs. Names are cut to 15 characters on Linux. Off by default.
+     */
+    void setNameWorkerThreads(bool should_name_worker_threads) { nameWorkerThreads.store(should_name_worker_threads); }
+    
+    CallbackDrainStatistics getCallbackDrainStatistics() const
+    {
+        CallbackDrainStatistics statistics;
+        statistics.numDrains = drainTime.getCount();
+        statistics.numIdleDrains = numIdleDrains.load();
+        statistics.progressCallbacks = numProgressCallbacksDelivered.load();
+        statistics.completionCallbacks = numCompletionsDelivered.load();
+        statistics.maxCallbacksPerDrain = maxCallbacksPerDrain.load();
+        statistics.meanMicroseconds = drainTime.getMeanMicroseconds();
+        statistics.p50Microseconds = drainTime.getPercentile(50.0);
+        statistics.p95Microseconds = drainTime.getPercentile(95.0);
+        statistics.p99Microseconds = drainTime.getPercentile(99.0);
+        statistics.maxMicroseconds = drainTime.getMaxMicroseconds();
+        statistics.totalMicroseconds = totalDrainMicroseconds.load();
+        statistics.p99ProgressMicroseconds = progressDrainTime.getPercentile(99.0);
+        statistics.p99CompletionMicroseconds = completionDrainTime.getPercentile(99.0);
+        return statistics;
+    }
+    
+    LatencyStatistics getLatencyStatistics(Job::Priority priority) const
+    {
+        const JobLatency& latency = jobLatency[Job::getPriorityIndex(priority)];
+        return LatencyStatistics { latency.queueWait.getSummary(), latency.runTime.getSummary(), latency.callbackDelay.getSummary(), latency.endToEnd.getSummary() };
+    }
+    
+    /**
+     Sets the latency objective for a priority and metric, replacing any previous one. The scheduler evaluates it every half window.
+     Samples taken before the call are discarded, so the first evaluation only judges latencies seen under the new objective.
+     */
+    void setLatencyObjective(Job::Priority priority, LatencyObjective objective)
+    {
+        ScopedLock lock(objectiveLock);
+        ObjectiveState& state = objectives[Job::getPriorityIndex(priority)][objective.metric];
+        state.objective = objective;
+        state.enabled = true;
+        state.breached = false;
+        state.nextEvaluationTime = now() + objective.windowMs * 0.5;
+        objectiveWindows[Job::getPriorityIndex(priority)][objective.metric].reset();
+        hasObjectives.store(true);
+    }
+    void clearLatencyObjective(Job::Priority priority, LatencyObjective::Metric metric)
+    {
+        ScopedLock lock(objectiveLock);
+        objectives[Job::getPriorityIndex(priority)][metric].enabled = false;
+    }
+    
+    /**
+     Called on the scheduler thread when an objective becomes breached, and again when it recovers. Keep it short, it stalls scheduling.
+     */
+    void setObjectiveCallback(std::function<void(const ObjectiveEvent&)>&& objective_callback)
+    {
+        ScopedLock lock(objectiveLock);
+        objectiveCallback = std::move(objective_callback);
+    }
+    
+    /**
+     Asks the scheduler to take a QueueSnapshot on its next pass. Never blocks, collect the result with getLatestSnapshot(). The pass pays for the snapshot, see setSnapshotLimit().
+     */
+    void requestSnapshot() { snapshotRequested.store(true); notify(); }
+    
+    /**
+     Has the scheduler take a QueueSnapshot on its own every interval, so a diagnostics panel can poll getLatestSnapshot(). Zero turns it off.
+     */
+    void setSnapshotInterval(double interval_ms) { snapshotIntervalMs.store(interval_ms); }
+    
+    /**
+     Caps how many queued jobs a QueueSnapshot lists, 256 by default. A snapshot is taken inside a scheduler pass and costs time in the listed, parked and running jobs,
+     so a large cap delays dispatch on a deep queue. Per-priority counts and oldest ages are always complete.
+     */
+    void setSnapshotLimit(size_t max_listed_jobs) { snapshotJobLimit.store(max_listed_jobs); }
+    
+    /**
+     The last QueueSnapshot the scheduler published, or an empty one before the first. Published snapshots are never modified, so it can be kept and read from any thread.
+     Only waits for the scheduler to swap a pointer, never for a snapshot to be taken or copied.
+     */
+    std::shared_ptr<const QueueSnapshot> getLatestSnapshot() const
+    {
+        ScopedLock lock(snapshotLock);
+        return latestSnapshot;
+    }
+    
+    void resetStatistics()
+    {
+        for (WorkerSlot& slot : workerSlots)
+        {
+            slot.jobsRun.store(0);
+            slot.busyMs.store(0);
+            slot.cpuMs.store(0);
+            slot.allocations.store(0);
+            slot.allocatedBytes.store(0);
+            slot.jobTypeTotals.reset();
+            slot.ownerTotals.reset();
+        }
+        for (JobLatency& latency : jobLatency)
+        {
+            latency.queueWait.reset();
+            latency.runTime.reset();
+            latency.callbackDelay.reset();
+            latency.endToEnd.reset();
+        }
+        drainTime.reset();
+        progressDrainTime.reset();
+        completionDrainTime.reset();
+        totalDrainMicroseconds.store(0);
+        numIdleDrains.store(0);
+        numProgressCallbacksDelivered.store(0);
+        numCompletionsDelivered.store(0);
+        maxCallbacksPerDrain.store(0);
+        statisticsStartTime.store(now());
     }
     
     void addCallback(const juce::Identifier& callback_id, FunctionScope<void()>* scope, std::function<void()>&& function)
@@ -133,6 +665,35 @@ public:
         progressCallbackMap[callback_id]->add(scope, std::move(function));
     }
     
+    /**
+     Makes the container behind callback_id coalesce, so it runs once per priority in each message thread drain however many jobs completed into it. See ScopedFunctionContainer::setCoalescing().
+     */
+    void setCallbackCoalescing(const juce::Identifier& callback_id, bool should_coalesce)
+    {
+        if (callbackMap.find(callback_id) == callbackMap.end())
+            callbackMap.emplace(callback_id, std::make_unique<JJS::ScopedFunctionContainer<void()>>());
+        callbackMap[callback_id]->setCoalescing(should_coalesce);
+    }
+    
+    /**
+     Runs the callbacks of jobs pushed with this container on the given executor instead of the message thread, unless the job has its own, see Job::setCompletionExecutor(). Null restores the message thread.
+     */
+    void setCallbackExecutor(ScopedFunctionContainer<void()>* callbacks, CompletionExecutor* executor)
+    {
+        ScopedLock lock(executorLock);
+        if (executor != nullptr)
+            callbackExecutors[callbacks] = executor;
+        else
+            callbackExecutors.erase(callbacks);
+        hasCallbackExecutors.store(!callbackExecutors.empty());
+    }
+    void setCallbackExecutor(const juce::Identifier& callback_id, CompletionExecutor* executor)
+    {
+        if (callbackMap.find(callback_id) == callbackMap.end())
+            callbackMap.emplace(callback_id, std::make_unique<JJS::ScopedFunctionContainer<void()>>());
+        setCallbackExecutor(callbackMap[callback_id].get(), executor);
+    }
+    
     void triggerCallbacks(ScopedFunctionContainer<void()>* callbacks)
     {
         if (!callbacks)
@@ -140,7 +701,7 @@ public:
         if (juce::MessageManager::getInstance()->isThisTheMessageThread())
             callbacks->triggerFunctions();
         else
-            finishedJobs.push(std::make_shared<Job>([](){}, [callbacks]()
+            pushFinishedJob(std::make_shared<Job>([](){}, [callbacks]()
             {
                 callbacks->triggerFunctions();
             }));
@@ -156,6 +717,105 @@ public:
     }
     
 private:
+    /**
+     State of one concurrent job lane. Only the scheduler claims a slot, and only the worker running in it releases it.
+     */
+    struct WorkerSlot
+    {
+        std::atomic<bool> busy { false };
+        std::atomic<bool> timedOut { false };
+        std::atomic<juce::uint64> jobId { 0 };
+        std::atomic<const char*> jobName { nullptr };
+        std::atomic<const char*> jobCategory { nullptr };
+        std::atomic<const void*> owner { nullptr };
+        std::atomic<const char*> ownerName { nullptr };
+        std::atomic<double> queuedTime { 0 };
+        std::atomic<int> priority { Job::Priority::Normal };
+        std::atomic<double> startTime { 0 };
+        std::atomic<double> timeLimitMs { 0 };
+        std::atomic<size_t> jobBytes { 0 };
+        std::atomic<OrderedChannel*> orderedChannel { nullptr };
+        std::atomic<juce::uint64> orderedSequence { 0 };
+        std::atomic<size_t> dispatchQueueDepth { 0 }; // Jobs still queued when this one was dispatched, for the start and finish probes
+        std::atomic<int> leases { 0 };
+        std::atomic<bool> started { false };
+        bool isBackground { false };
+        std::atomic<juce::uint64> jobsRun { 0 };
+        std::atomic<double> busyMs { 0 };
+        std::atomic<double> cpuMs { 0 };
+        std::atomic<juce::uint64> allocations { 0 };
+        std::atomic<juce::uint64> allocatedBytes { 0 };
+        JobTypeTotals jobTypeTotals; // Only this worker adds to these
+        OwnerTotals ownerTotals;
+    };
+    
+    /**
+     Keeps a WorkerSlot claimed while any copy of the pool job holding it exists, so jobs removed from the pool before they ran still release their slot.
+     */
+    class SlotLease
+    {
+    public:
+        SlotLease(JobSystem& job_system, WorkerSlot& worker_slot) : system(&job_system), slot(&worker_slot) { slot->leases++; }
+        SlotLease(const SlotLease& other) : system(other.system), slot(other.slot) { slot->leases++; }
+        SlotLease& operator=(const SlotLease&) = delete;
+        ~SlotLease()
+        {
+            if (--slot->leases == 0)
+                system->releaseWorkerSlot(*slot);
+        }
+        WorkerSlot& getSlot() const { return *slot; }
+    private:
+        JobSystem* system;
+        WorkerSlot* slot;
+    };
+    
+    struct JobLatency
+    {
+        LatencyHistogram queueWait;
+        LatencyHistogram runTime;
+        LatencyHistogram callbackDelay;
+        LatencyHistogram endToEnd;
+    };
+    
+    struct ObjectiveState
+    {
+        LatencyObjective objective;
+        bool enabled { false };
+        bool breached { false };
+        double nextEvaluationTime { 0 };
+    };
+    
+    struct PriorityChange
+    {
+        juce::uint64 jobId { 0 };
+        Job::Priority priority { Job::Priority::Normal };
+    };
+    
+    // Called under criticalSection. A full FIFO spills into the overflow rather than losing the change
+    void pushPriorityChange(const PriorityChange& change)
+    {
+        if (hasOverflowPriorityChanges.load() || !priorityChanges.push(change))
+        {
+            overflowPriorityChanges.push_back(change);
+            hasOverflowPriorityChanges.store(true);
+        }
+    }
+    
+    void applyPriorityChange(const PriorityChange& change)
+    {
+        if (prioritizedJobs.setPriority(change.jobId, change.priority))
+            return;
+        // Ordered jobs waiting for their channel are not in the queue, the new priority applies once they are requeued
+        for (std::unique_ptr<Job>& parked : parkedJobs)
+        {
+            if (parked->id == change.jobId)
+            {
+                parked->priority = change.priority;
+                return;
+            }
+        }
+    }
+    
     bool processJobs()
     {
         // Prioritize Jobs
@@ -165,27 +825,418 @@ private:
             jobToPrioritize->queuePosition = queueCounter++;
             prioritizedJobs.pushJob(std::move(jobToPrioritize));
         }
+        if (hasOverflowInputJobs.load())
+        {
+            ScopedLock lock(inputLock);
+            while (inputJobs.getNumItems() > 0) // Pushed before the overflow started
+            {
+                std::unique_ptr<Job> jobToPrioritize = inputJobs.pop();
+                jobToPrioritize->queuePosition = queueCounter++;
+                prioritizedJobs.pushJob(std::move(jobToPrioritize));
+            }
+            for (std::unique_ptr<Job>& jobToPrioritize : overflowInputJobs)
+            {
+                jobToPrioritize->queuePosition = queueCounter++;
+                prioritizedJobs.pushJob(std::move(jobToPrioritize));
+            }
+            overflowInputJobs.clear();
+            hasOverflowInputJobs.store(false);
+        }
+        
+        // Move Reprioritized Jobs Between Buckets
+        while (priorityChanges.getNumItems() > 0)
+            applyPriorityChange(priorityChanges.pop());
+        if (hasOverflowPriorityChanges.load())
+        {
+            ScopedLock lock(criticalSection);
+            while (priorityChanges.getNumItems() > 0) // Pushed before the overflow started
+                applyPriorityChange(priorityChanges.pop());
+            for (const PriorityChange& change : overflowPriorityChanges)
+                applyPriorityChange(change);
+            overflowPriorityChanges.clear();
+            hasOverflowPriorityChanges.store(false);
+        }
+        
+        // Requeue Ordered Jobs Their Channel Has Caught Up With
+        for (auto parked = parkedJobs.begin(); parked != parkedJobs.end();)
+        {
+            if ((*parked)->orderedChannel->canDispatch((*parked)->orderedSequence))
+            {
+                prioritizedJobs.pushJob(std::move(*parked));
+                parked = parkedJobs.erase(parked);
+            }
+            else
+                ++parked;
+        }
+        
+        // Shed Jobs Past Their Queue Limits
+        for (size_t priority = 0; priority < Job::numPriorities; ++priority)
+        {
+            const double maxAge = maxQueueAgeMs[priority].load();
+            const int maxDepth = maxQueueDepth[priority].load();
+            if (maxAge <= 0 && maxDepth <= 0)
+                continue;
+            const double oldestAllowedTime = maxAge > 0 ? now() - maxAge : 0;
+            std::unique_ptr<Job> staleJob = prioritizedJobs.popStaleJob(Job::getPriorityFromIndex(priority), static_cast<size_t>(juce::jmax(0, maxDepth)), oldestAllowedTime);
+            while (staleJob != nullptr)
+            {
+                dropJob(std::move(staleJob));
+                staleJob = prioritizedJobs.popStaleJob(Job::getPriorityFromIndex(priority), static_cast<size_t>(juce::jmax(0, maxDepth)), oldestAllowedTime);
+            }
+        }
+        if (prioritizedJobs.empty() && parkedJobs.empty())
+            queueCounter = 0;
+        priorityQueueBytes.store(prioritizedJobs.getMemoryUsage() + parkedJobs.capacity() * sizeof(std::unique_ptr<Job>), std::memory_order_relaxed);
+        
+        checkForOverdueJobs();
+        takeSnapshotIfDue();
+        evaluateObjectives();
         
-        // Ensure JobSystem is Ready for New Job
-        if (threadPool.getNumJobs() >= threadPool.getNumThreads() || prioritizedJobs.empty())
+        // Ensure JobSystem is Ready for New Job, hung jobs hand their worker over to a spare
+        const int concurrencyLimit = numConcurrentJobs + juce::jmin(numHungJobs.load(), numSpareWorkers);
+        const int slot = findFreeWorkerSlot();
+        const bool poolIsFull = getNumPoolJobs() >= concurrencyLimit || slot < 0;
+        const bool foregroundIsWaiting = !prioritizedJobs.empty() && prioritizedJobs.getHighestPriority() != Job::Priority::Background;
+        yieldBackground.store(poolIsFull && foregroundIsWaiting && runningBackgroundJobs.load() > 0);
+        if (poolIsFull || prioritizedJobs.empty())
             return true;
         
-        // Run Highest Priority Job
-        std::unique_ptr<Job> jobToRun = prioritizedJobs.popJob();
-        threadPool.addJob([&, job = std::shared_ptr<Job>(jobToRun.release())]() mutable
+        // Run Highest Priority Job, Background Jobs only reach the top when nothing else is queued
+        std::unique_ptr<Job> jobToRun = prioritizedJobs.popJob(dispatchCandidateWindow.load());
+        while (jobToRun->orderedChannel != nullptr && !jobToRun->orderedChannel->canDispatch(jobToRun->orderedSequence))
+        {
+            // Too far ahead of its channel's delivery, it waits so the reorder buffer stays bounded
+            parkedJobs.push_back(std::move(jobToRun));
+            if (prioritizedJobs.empty())
+                return true;
+            jobToRun = prioritizedJobs.popJob(dispatchCandidateWindow.load());
+        }
+        WorkerSlot& workerSlot = workerSlots[static_cast<size_t>(slot)];
+        workerSlot.isBackground = jobToRun->priority == Job::Priority::Background;
+        if (workerSlot.isBackground)
+            runningBackgroundJobs++;
+        workerSlot.timedOut.store(false);
+        workerSlot.started.store(false);
+        workerSlot.jobId.store(jobToRun->id);
+        workerSlot.jobName.store(jobToRun->name);
+        workerSlot.jobCategory.store(jobToRun->category);
+        workerSlot.owner.store(jobToRun->owner);
+        workerSlot.ownerName.store(jobToRun->ownerName);
+        workerSlot.queuedTime.store(jobToRun->queuedTime);
+        workerSlot.priority.store(jobToRun->priority);
+        workerSlot.timeLimitMs.store(jobToRun->timeLimitMs);
+        workerSlot.jobBytes.store(jobToRun->accountedBytes);
+        workerSlot.orderedChannel.store(jobToRun->orderedChannel);
+        workerSlot.orderedSequence.store(jobToRun->orderedSequence);
+        workerSlot.dispatchQueueDepth.store(prioritizedJobs.size());
+        queuedJobBytes -= jobToRun->accountedBytes;
+        activeJobBytes += jobToRun->accountedBytes;
+        workerSlot.startTime.store(now()); // Until the worker starts the job, so the watchdog and snapshots see the handoff too
+        workerSlot.busy.store(true);
+        jobToRun->timedOut = &workerSlot.timedOut;
+        recordEvent(FlightRecorder::SchedulerLane, FlightRecorder::Dispatch, *jobToRun);
+        JJS_PROBE(job__dispatch, jobToRun->id, jobToRun->priority, prioritizedJobs.size(), jobToRun->getName());
+        const double simulatedDuration = jobToRun->simulatedDurationMs;
+        addPoolJob([&, lease = SlotLease(*this, workerSlot), lane = FlightRecorder::FirstWorkerLane + slot, job = std::shared_ptr<Job>(jobToRun.release())]() mutable
         {
+            recordEvent(lane, FlightRecorder::Start, *job);
+            JJS_PROBE(job__start, job->id, job->priority, lease.getSlot().dispatchQueueDepth.load(), job->getName());
+            if (nameWorkerThreads.load(std::memory_order_relaxed) && simulation == nullptr)
+                nameCurrentThread(*job);
+            // Taken here so the pool's handoff counts as queue wait rather than busy time. Simulated jobs run at their virtual end, and start at dispatch
+            const double startTime = simulation != nullptr ? lease.getSlot().startTime.load() : now();
+            lease.getSlot().startTime.store(startTime);
+            const double startCpuTime = getThreadCpuTimeMs();
+            const AllocationCounts startAllocations = threadAllocationCounts;
+            lease.getSlot().started.store(true);
             job->executeAction();
+            job->timedOut = nullptr;
+            job->finishedTime = now();
+            const AllocationCounts allocations = getThreadAllocationsSince(startAllocations);
+            accountJob(lease.getSlot(), *job, startTime - job->queuedTime, now() - startTime, getThreadCpuTimeMs() - startCpuTime, allocations);
+            recordEvent(lane, FlightRecorder::Finish, *job);
+            JJS_PROBE(job__finish, job->id, job->priority, lease.getSlot().dispatchQueueDepth.load(), job->getName());
             if (abort.load())
+            {
+                numFlushedJobs++;
+                activeJobBytes -= job->accountedBytes;
+                skipOrderedJob(job->orderedChannel, job->orderedSequence);
                 return;
-            juce::ScopedLock lock(criticalSection);
-            finishedJobs.push(job);
-        });
-        if (prioritizedJobs.empty())
+            }
+            postFinishedJob(std::move(job));
+        }, simulatedDuration);
+        if (prioritizedJobs.empty() && parkedJobs.empty())
             queueCounter = 0;
         
         return false;
     }
     
+    void accountJob(WorkerSlot& slot, const Job& job, double queue_wait_ms, double wall_ms, double cpu_ms, const AllocationCounts& allocations)
+    {
+        slot.jobsRun++;
+        slot.busyMs.store(slot.busyMs.load() + wall_ms);
+        slot.cpuMs.store(slot.cpuMs.load() + cpu_ms);
+        slot.allocations += allocations.allocations;
+        slot.allocatedBytes += allocations.bytes;
+        slot.jobTypeTotals.add(job.tagId, job.name, job.category, cpu_ms, wall_ms, allocations);
+        slot.ownerTotals.add(job.owner, job.ownerName, cpu_ms, wall_ms, queue_wait_ms);
+        jobLatency[Job::getPriorityIndex(job.priority)].queueWait.add(queue_wait_ms * 1000.0);
+        objectiveWindows[Job::getPriorityIndex(job.priority)][LatencyObjective::QueueWait].add(queue_wait_ms * 1000.0);
+        jobLatency[Job::getPriorityIndex(job.priority)].runTime.add(wall_ms * 1000.0);
+    }
+    
+    int findFreeWorkerSlot() const
+    {
+        for (size_t i = 0; i < workerSlots.size(); ++i)
+            if (!workerSlots[i].busy.load())
+                return static_cast<int>(i);
+        return -1;
+    }
+    
+    void releaseWorkerSlot(WorkerSlot& slot)
+    {
+        if (slot.isBackground)
+            runningBackgroundJobs--;
+        if (slot.timedOut.load())
+            numHungJobs--;
+        if (!slot.started.load()) // Removed from the pool by flush() before it ran
+        {
+            numFlushedJobs++;
+            activeJobBytes -= slot.jobBytes.load();
+            skipOrderedJob(slot.orderedChannel.load(), slot.orderedSequence.load());
+        }
+        slot.busy.store(false);
+        // The scheduler sleeps while every worker is busy, wake it so queued jobs don't wait out its tick
+        if (simulation == nullptr)
+            notify();
+    }
+    
+    void checkForOverdueJobs()
+    {
+        const double currentTime = now();
+        for (size_t i = 0; i < workerSlots.size(); ++i)
+        {
+            WorkerSlot& slot = workerSlots[i];
+            const double timeLimit = slot.timeLimitMs.load();
+            if (!slot.busy.load() || timeLimit <= 0 || slot.timedOut.load())
+                continue;
+            const double runningMs = currentTime - slot.startTime.load();
+            if (runningMs <= timeLimit)
+                continue;
+            
+            numHungJobs++;
+            slot.timedOut.store(true);
+            ScopedLock lock(watchdogLock);
+            if (watchdogCallback)
+                watchdogCallback(OverdueJobInfo { slot.jobId.load(), slot.jobName.load(), slot.jobCategory.load(), static_cast<Job::Priority>(slot.priority.load()), static_cast<int>(i), runningMs, timeLimit });
+        }
+    }
+    
+    void takeSnapshotIfDue()
+    {
+        const double currentTime = now();
+        const double interval = snapshotIntervalMs.load();
+        const bool intervalElapsed = interval > 0 && currentTime - lastSnapshotTime >= interval;
+        if (!snapshotRequested.exchange(false) && !intervalElapsed)
+            return;
+        lastSnapshotTime = currentTime;
+        
+        auto snapshot = std::make_shared<QueueSnapshot>();
+        snapshot->time = currentTime;
+        snapshot->numUnsortedJobs = inputJobs.getNumItems();
+        snapshot->numQueued = prioritizedJobs.size() + parkedJobs.size();
+        for (size_t priority = 0; priority < Job::numPriorities; ++priority)
+        {
+            QueueSnapshot::PriorityInfo& info = snapshot->byPriority[priority];
+            info.numQueued = prioritizedJobs.size(Job::getPriorityFromIndex(priority));
+            if (const Job* oldest = prioritizedJobs.getOldestJob(Job::getPriorityFromIndex(priority)))
+                info.oldestAgeMs = currentTime - oldest->queuedTime;
+        }
+        // Listing is the only part that grows with the queue, so it stops at the limit
+        const size_t maxListedJobs = snapshotJobLimit.load();
+        snapshot->queued.reserve(juce::jmin(maxListedJobs, snapshot->numQueued));
+        prioritizedJobs.forEachJob([&](const Job& job)
+        {
+            snapshot->queued.push_back(JobInfo { job.id, job.name, job.category, job.priority, job.owner, job.ownerName, currentTime - job.queuedTime, 0, -1 });
+        }, maxListedJobs);
+        for (const std::unique_ptr<Job>& job : parkedJobs)
+        {
+            QueueSnapshot::PriorityInfo& info = snapshot->byPriority[Job::getPriorityIndex(job->priority)];
+            info.numQueued++;
+            info.oldestAgeMs = juce::jmax(info.oldestAgeMs, currentTime - job->queuedTime);
+            if (snapshot->queued.size() < maxListedJobs)
+                snapshot->queued.push_back(JobInfo { job->id, job->name, job->category, job->priority, job->owner, job->ownerName, currentTime - job->queuedTime, 0, -1 });
+        }
+        for (size_t i = 0; i < workerSlots.size(); ++i)
+        {
+            const WorkerSlot& slot = workerSlots[i];
+            if (!slot.busy.load())
+                continue;
+            snapshot->running.push_back(JobInfo { slot.jobId.load(), slot.jobName.load(), slot.jobCategory.load(), static_cast<Job::Priority>(slot.priority.load()), slot.owner.load(), slot.ownerName.load(),
+                                                 currentTime - slot.queuedTime.load(), currentTime - slot.startTime.load(), static_cast<int>(i) });
+        }
+        
+        std::shared_ptr<const QueueSnapshot> published = std::move(snapshot);
+        {
+            ScopedLock lock(snapshotLock);
+            std::swap(latestSnapshot, published);
+        }
+        // The previous snapshot is released here, outside the lock, if no reader still holds it
+    }
+    
+    void evaluateObjectives()
+    {
+        if (!hasObjectives.load())
+            return;
+        const double currentTime = now();
+        ScopedLock lock(objectiveLock);
+        for (size_t priority = 0; priority < Job::numPriorities; ++priority)
+        {
+            for (size_t metric = 0; metric < static_cast<size_t>(LatencyObjective::numMetrics); ++metric)
+            {
+                ObjectiveState& state = objectives[priority][metric];
+                if (!state.enabled || currentTime < state.nextEvaluationTime)
+                    continue;
+                state.nextEvaluationTime = currentTime + state.objective.windowMs * 0.5;
+                
+                SlidingLatencyWindow& window = objectiveWindows[priority][metric];
+                const juce::uint64 numSamples = window.getCount();
+                const double observedMs = window.getPercentileLowerBound(state.objective.percentile) / 1000.0;
+                window.rotate();
+                // Too few samples can't confirm a breach is still going on, so it ends rather than outlasting the traffic
+                const bool insufficientSamples = numSamples < static_cast<juce::uint64>(juce::jmax(1, state.objective.minSamples));
+                const bool breached = !insufficientSamples && observedMs > state.objective.thresholdMs;
+                if (breached == state.breached)
+                    continue;
+                state.breached = breached;
+                if (objectiveCallback)
+                    objectiveCallback(ObjectiveEvent { Job::getPriorityFromIndex(priority), state.objective, observedMs, numSamples, breached, insufficientSamples });
+            }
+        }
+    }
+    
+    void dropJob(std::unique_ptr<Job> job)
+    {
+        numDroppedJobs++;
+        job->dropped = true;
+        queuedJobBytes -= job->accountedBytes;
+        activeJobBytes += job->accountedBytes;
+        recordEvent(FlightRecorder::SchedulerLane, FlightRecorder::Drop, *job);
+        JJS_PROBE(job__drop, job->id, job->priority, prioritizedJobs.size(), job->getName());
+        postFinishedJob(std::shared_ptr<Job>(job.release()));
+    }
+    
+    /**
+     Hands a finished or dropped job to its completion executor, or queues it for the message thread.
+     */
+    void postFinishedJob(std::shared_ptr<Job>&& job)
+    {
+        CompletionExecutor* executor = job->orderedChannel == nullptr ? job->completionExecutor : nullptr;
+        if (executor == nullptr)
+        {
+            pushFinishedJob(std::move(job));
+            return;
+        }
+        executor->post([this, job = std::move(job)]() { deliverFinishedJob(*job); });
+    }
+    
+    void pushFinishedJob(std::shared_ptr<Job>&& job)
+    {
+        ScopedLock lock(criticalSection);
+        if (hasOverflowFinishedJobs.load() || !finishedJobs.push(std::move(job)))
+        {
+            overflowFinishedJobs.push_back(std::move(job));
+            hasOverflowFinishedJobs.store(true);
+        }
+    }
+    
+    void discardFinishedJob(const Job& job)
+    {
+        if (job.id != 0) // Jobs made by triggerCallbacks() were never pushed
+            numFlushedJobs++;
+        activeJobBytes -= job.accountedBytes;
+        skipOrderedJob(job.orderedChannel, job.orderedSequence);
+    }
+    
+    /**
+     Delivers a finished job, or hands it to its ordered channel, which delivers whatever is now due. Returns the number of jobs delivered.
+     */
+    int routeFinishedJob(std::shared_ptr<Job>&& job)
+    {
+        OrderedChannel* channel = job->orderedChannel;
+        if (channel == nullptr)
+        {
+            deliverFinishedJob(*job);
+            return 1;
+        }
+        const juce::uint64 sequence = job->orderedSequence;
+        channel->add(sequence, std::move(job));
+        return channel->deliverReady([this](Job& ready) { deliverFinishedJob(ready); });
+    }
+    
+    /**
+     Leaves a gap for a flushed job, so its channel does not wait for it forever.
+     */
+    void skipOrderedJob(OrderedChannel* channel, juce::uint64 sequence)
+    {
+        if (channel == nullptr)
+            return;
+        channel->add(sequence, nullptr);
+        hasOrderedGaps.store(true);
+    }
+    
+    void deliverFinishedJob(Job& job)
+    {
+        recordEvent(FlightRecorder::MessageThreadLane, FlightRecorder::Callback, job);
+        JJS_PROBE(job__callback, job.id, job.priority, finishedJobs.getNumItems(), job.getName());
+        job.executeCallback();
+        activeJobBytes -= job.accountedBytes;
+        if (job.id == 0)
+            return;
+        numDeliveredJobs++;
+        if (!job.dropped)
+        {
+            const double currentTime = now();
+            jobLatency[Job::getPriorityIndex(job.priority)].callbackDelay.add((currentTime - job.finishedTime) * 1000.0);
+            jobLatency[Job::getPriorityIndex(job.priority)].endToEnd.add((currentTime - job.queuedTime) * 1000.0);
+            objectiveWindows[Job::getPriorityIndex(job.priority)][LatencyObjective::EndToEnd].add((currentTime - job.queuedTime) * 1000.0);
+        }
+    }
+    
+    void recordEvent(int lane, FlightRecorder::EventType type, const Job& job)
+    {
+        if (FlightRecorder* recorder = flightRecorder.load())
+        {
+            if (type == FlightRecorder::Push)
+                recorder->registerTag(job.tagId, job.category, job.name);
+            recorder->record(lane, type, job.id, job.priority, job.tagId);
+        }
+    }
+    
+    static void nameCurrentThread(const Job& job)
+    {
+        thread_local juce::uint32 currentTagId = 0;
+        if (job.tagId == currentTagId)
+            return;
+        currentTagId = job.tagId;
+       #if JUCE_LINUX
+        juce::Thread::setCurrentThreadName(juce::String(job.getName()).substring(0, 15)); // pthread names are limited to 15 characters
+       #else
+        juce::Thread::setCurrentThreadName(job.getName());
+       #endif
+    }
+    
+    double now() const { return simulation != nullptr ? simulation->getTime() : juce::Time::getMillisecondCounterHiRes(); }
+    
+    void addPoolJob(std::function<void()>&& work, double simulated_duration_ms)
+    {
+        if (simulation != nullptr)
+            simulation->startJob(std::move(work), simulated_duration_ms);
+        else
+            threadPool->addJob(std::move(work));
+    }
+    int getNumPoolJobs() const { return simulation != nullptr ? simulation->getNumRunningJobs() : threadPool->getNumJobs(); }
+    
     void run() override
     {
         while (!threadShouldExit())
@@ -193,26 +1244,181 @@ private:
                 wait(2);
     }
     
+    /**
+     Delivers every finished job, Urgent first. Each priority gets its own CoalescedTriggerBatch, so coalescing containers triggered by Urgent callbacks
+     run before any Normal callback rather than after the whole drain.
+     */
+    int deliverCompletions()
+    {
+        int numCompletions = 0;
+        {
+            // flush() may pop from another thread, callbacks run after this lock is released
+            ScopedLock consumer(consumerLock);
+            while (finishedJobs.getNumItems() > 0)
+            {
+                std::shared_ptr<Job> job = finishedJobs.pop();
+                completionsByPriority[Job::getPriorityIndex(job->priority)].push_back(std::move(job));
+            }
+            if (hasOverflowFinishedJobs.load())
+            {
+                ScopedLock lock(criticalSection);
+                while (finishedJobs.getNumItems() > 0) // Pushed before the overflow started
+                {
+                    std::shared_ptr<Job> job = finishedJobs.pop();
+                    completionsByPriority[Job::getPriorityIndex(job->priority)].push_back(std::move(job));
+                }
+                for (std::shared_ptr<Job>& job : overflowFinishedJobs)
+                    completionsByPriority[Job::getPriorityIndex(job->priority)].push_back(std::move(job));
+                overflowFinishedJobs.clear();
+                hasOverflowFinishedJobs.store(false);
+            }
+        }
+        // Urgent callbacks first, so bulk completions can't hold them back a whole drain. Finish order is kept within a priority.
+        for (size_t priority = Job::numPriorities; priority-- > 0;)
+        {
+            if (completionsByPriority[priority].empty())
+                continue;
+            CoalescedTriggerBatch coalescedTriggers;
+            for (std::shared_ptr<Job>& job : completionsByPriority[priority])
+                numCompletions += routeFinishedJob(std::move(job));
+            completionsByPriority[priority].clear();
+        }
+        if (hasOrderedGaps.exchange(false))
+        {
+            CoalescedTriggerBatch coalescedTriggers;
+            ScopedLock lock(channelLock);
+            for (const std::unique_ptr<OrderedChannel>& channel : orderedChannels)
+                numCompletions += channel->deliverReady([this](Job& ready) { deliverFinishedJob(ready); });
+        }
+        return numCompletions;
+    }
+    
     void timerCallback() override
     {
+        JJS_PROBE(callbacks__drain, 0, 0, finishedJobs.getNumItems(), "");
+        if (progressCallbackFIFO.getNumItems() == 0 && !hasOverflowProgressCallbacks.load() && finishedJobs.getNumItems() == 0 && !hasOverflowFinishedJobs.load() && !hasOrderedGaps.load())
+        {
+            numIdleDrains++;
+            return;
+        }
+        
+        // Time each drain, as it is the share of a UI frame that the JobSystem takes
+        const juce::int64 drainStart = juce::Time::getHighResolutionTicks();
+        int numProgress = 0;
         while (progressCallbackFIFO.getNumItems() > 0)
+        {
             progressCallbackFIFO.pop()();
-        while (finishedJobs.getNumItems() > 0)
-            finishedJobs.pop()->executeCallback();
+            numProgress++;
+        }
+        if (hasOverflowProgressCallbacks.load())
+        {
+            {
+                // Taken out under the lock, but run outside it so workers reporting progress never wait on a callback
+                ScopedLock lock(criticalSection);
+                while (progressCallbackFIFO.getNumItems() > 0) // Pushed before the overflow started
+                    drainingProgressCallbacks.push_back(progressCallbackFIFO.pop());
+                for (std::function<void()>& progressCallback : overflowProgressCallbacks)
+                    drainingProgressCallbacks.push_back(std::move(progressCallback));
+                overflowProgressCallbacks.clear();
+                hasOverflowProgressCallbacks.store(false);
+            }
+            for (std::function<void()>& progressCallback : drainingProgressCallbacks)
+                progressCallback();
+            numProgress += static_cast<int>(drainingProgressCallbacks.size());
+            drainingProgressCallbacks.clear();
+        }
+        const juce::int64 progressEnd = juce::Time::getHighResolutionTicks();
+        const int numCompletions = deliverCompletions();
+        const juce::int64 drainEnd = juce::Time::getHighResolutionTicks();
+        
+        progressDrainTime.addTicks(progressEnd - drainStart);
+        completionDrainTime.addTicks(drainEnd - progressEnd);
+        drainTime.addTicks(drainEnd - drainStart);
+        totalDrainMicroseconds.store(totalDrainMicroseconds.load() + static_cast<double>(drainEnd - drainStart) * 1000000.0 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+        numProgressCallbacksDelivered += static_cast<juce::uint64>(numProgress);
+        numCompletionsDelivered += static_cast<juce::uint64>(numCompletions);
+        if (numProgress + numCompletions > maxCallbacksPerDrain.load())
+            maxCallbacksPerDrain.store(numProgress + numCompletions);
     }
     
-    juce::ThreadPool threadPool;
+    friend class Simulation;
+    SimulationDriver* const simulation { nullptr };
+    const int numConcurrentJobs;
+    const int numSpareWorkers;
+    std::vector<WorkerSlot> workerSlots;
     LockFreeFifo<std::unique_ptr<Job>> inputJobs { 2048 };
+    std::vector<std::unique_ptr<Job>> overflowInputJobs;
+    std::atomic<bool> hasOverflowInputJobs { false };
+    CriticalSection inputLock { "JobSystem Input" };
     JobQueue prioritizedJobs;
-    std::vector<std::unique_ptr<Job>> runningJobs;
+    std::vector<std::unique_ptr<Job>> parkedJobs; // Ordered jobs waiting for their channel to catch up
+    LockFreeFifo<PriorityChange> priorityChanges { 2048 };
+    std::vector<PriorityChange> overflowPriorityChanges;
+    std::atomic<bool> hasOverflowPriorityChanges { false };
     LockFreeFifo<std::function<void()>> progressCallbackFIFO { 2048 };
+    std::vector<std::function<void()>> overflowProgressCallbacks;
+    std::atomic<bool> hasOverflowProgressCallbacks { false };
+    std::vector<std::function<void()>> drainingProgressCallbacks; // Message thread only, reused every drain
     LockFreeFifo<std::shared_ptr<Job>> finishedJobs { 2048 };
-    juce::CriticalSection criticalSection;
+    std::vector<std::shared_ptr<Job>> overflowFinishedJobs;
+    std::atomic<bool> hasOverflowFinishedJobs { false };
+    std::array<std::vector<std::shared_ptr<Job>>, Job::numPriorities> completionsByPriority; // Message thread only, reused every drain
+    CriticalSection criticalSection { "JobSystem" };
+    CriticalSection consumerLock { "JobSystem Completions" }; // Single consumer side of finishedJobs, shared by the drain and flush()
     long queueCounter { 0 };
+    std::atomic<juce::uint64> jobIdCounter { 0 };
+    std::atomic<int> dispatchCandidateWindow { 16 };
     std::atomic<bool> abort { false };
+    std::atomic<bool> yieldBackground { false };
+    std::atomic<bool> nameWorkerThreads { false };
+    std::atomic<size_t> queuedJobBytes { 0 };
+    std::atomic<size_t> activeJobBytes { 0 };
+    std::atomic<size_t> priorityQueueBytes { 0 };
+    std::vector<std::unique_ptr<OrderedChannel>> orderedChannels;
+    std::atomic<bool> hasOrderedGaps { false };
+    CriticalSection channelLock { "JobSystem Channels" };
+    std::unordered_map<const ScopedFunctionContainer<void()>*, CompletionExecutor*> callbackExecutors;
+    std::atomic<bool> hasCallbackExecutors { false };
+    CriticalSection executorLock { "JobSystem Executors" };
+    std::atomic<int> runningBackgroundJobs { 0 };
+    std::array<std::atomic<double>, Job::numPriorities> maxQueueAgeMs {};
+    std::array<std::atomic<int>, Job::numPriorities> maxQueueDepth {};
+    std::atomic<juce::uint64> numDroppedJobs { 0 };
+    std::atomic<juce::uint64> numPushedJobs { 0 };
+    std::atomic<juce::uint64> numDeliveredJobs { 0 };
+    std::atomic<juce::uint64> numFlushedJobs { 0 };
+    std::atomic<int> numHungJobs { 0 };
+    CriticalSection watchdogLock { "JobSystem Watchdog" };
+    std::function<void(const OverdueJobInfo&)> watchdogCallback;
+    std::unique_ptr<FlightRecorder> ownedFlightRecorder;
+    std::atomic<FlightRecorder*> flightRecorder { nullptr };
+    std::atomic<double> statisticsStartTime { now() };
+    std::atomic<bool> snapshotRequested { false };
+    std::atomic<double> snapshotIntervalMs { 0 };
+    std::atomic<size_t> snapshotJobLimit { 256 };
+    double lastSnapshotTime { 0 };
+    std::shared_ptr<const QueueSnapshot> latestSnapshot { std::make_shared<const QueueSnapshot>() };
+    CriticalSection snapshotLock { "JobSystem Snapshot" };
+    std::array<JobLatency, Job::numPriorities> jobLatency;
+    std::array<std::array<SlidingLatencyWindow, LatencyObjective::numMetrics>, Job::numPriorities> objectiveWindows;
+    std::array<std::array<ObjectiveState, LatencyObjective::numMetrics>, Job::numPriorities> objectives;
+    std::atomic<bool> hasObjectives { false };
+    std::function<void(const ObjectiveEvent&)> objectiveCallback;
+    CriticalSection objectiveLock { "JobSystem Objectives" };
+    LatencyHistogram drainTime;
+    LatencyHistogram progressDrainTime;
+    LatencyHistogram completionDrainTime;
+    std::atomic<double> totalDrainMicroseconds { 0 }; // Only written by the message thread
+    std::atomic<juce::uint64> numIdleDrains { 0 };
+    std::atomic<juce::uint64> numProgressCallbacksDelivered { 0 };
+    std::atomic<juce::uint64> numCompletionsDelivered { 0 };
+    std::atomic<int> maxCallbacksPerDrain { 0 };
     
     std::map<juce::Identifier, std::unique_ptr<JJS::ScopedFunctionContainer<void()>>> callbackMap;
     std::map<juce::Identifier, std::unique_ptr<JJS::ScopedFunctionContainer<void(float)>>> progressCallbackMap;
+    
+    // Declared last so the pool, and every job still holding onto the members above, goes first
+    std::unique_ptr<juce::ThreadPool> threadPool;
 };
 
 } // JJS
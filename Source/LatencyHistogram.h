@@ -0,0 +1,184 @@
+/*
+  ==============================================================================
+
+    LatencyHistogram.h
+    Created: 18 Oct 2026 3:41:27pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+namespace JJS
+{
+
+/**
+ Lock-free histogram of durations in microseconds, cheap enough to add to from any thread on every event.
+ Buckets are 1 microsecond wide up to 8 microseconds, then every power of two range is split into 8 equal buckets, so a percentile is within 12.5% of the true value.
+ Percentiles are resolved to the upper edge of their bucket, but never above the largest sample, which is tracked exactly.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int subBucketBits = 3;
+    static constexpr int numSubBuckets = 1 << subBucketBits;
+    static constexpr int maxExponent = 31; // Samples of 2^32 microseconds or more, over an hour, share the last bucket
+    static constexpr int numBuckets = numSubBuckets + (maxExponent - subBucketBits + 1) * numSubBuckets;
+    
+    /** Percentile summary, in microseconds. */
+    struct Summary
+    {
+        juce::uint64 count { 0 };
+        double mean { 0 };
+        double p50 { 0 };
+        double p95 { 0 };
+        double p99 { 0 };
+        double max { 0 }; // Exact
+    };
+
+    void add(double microseconds)
+    {
+        microseconds = juce::jmax(0.0, microseconds);
+        buckets[static_cast<size_t>(getBucket(microseconds))].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        totalMicroseconds.fetch_add(static_cast<juce::uint64>(microseconds), std::memory_order_relaxed);
+        double previousMax = maxMicroseconds.load(std::memory_order_relaxed);
+        while (microseconds > previousMax && !maxMicroseconds.compare_exchange_weak(previousMax, microseconds, std::memory_order_relaxed))
+            ;
+    }
+    void addTicks(juce::int64 ticks)
+    {
+        add(static_cast<double>(ticks) * 1000000.0 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+    }
+    void reset()
+    {
+        for (auto& bucket : buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+        totalMicroseconds.store(0, std::memory_order_relaxed);
+        maxMicroseconds.store(0, std::memory_order_relaxed);
+    }
+    juce::uint64 getCount() const { return count.load(std::memory_order_relaxed); }
+    double getMeanMicroseconds() const
+    {
+        const juce::uint64 n = getCount();
+        return n > 0 ? static_cast<double>(totalMicroseconds.load(std::memory_order_relaxed)) / static_cast<double>(n) : 0.0;
+    }
+    double getMaxMicroseconds() const { return maxMicroseconds.load(std::memory_order_relaxed); }
+    /** Percentile in 0 - 100, returned in microseconds. */
+    double getPercentile(double percentile) const
+    {
+        const int bucket = findPercentileBucket(percentile, [this](int i) { return getBucketCount(i); });
+        return bucket < 0 ? 0.0 : juce::jmin(getBucketUpperEdge(bucket), getMaxMicroseconds());
+    }
+    Summary getSummary() const
+    {
+        Summary summary;
+        summary.count = getCount();
+        summary.mean = getMeanMicroseconds();
+        summary.p50 = getPercentile(50.0);
+        summary.p95 = getPercentile(95.0);
+        summary.p99 = getPercentile(99.0);
+        summary.max = getMaxMicroseconds();
+        return summary;
+    }
+    juce::uint64 getBucketCount(int bucket) const { return buckets[static_cast<size_t>(bucket)].load(std::memory_order_relaxed); }
+    /** Smallest value that lands in a bucket, see getBucket(). */
+    static double getBucketLowerEdge(int bucket) { return getBucketEdge(bucket, 0); }
+    /** Values up to, but not including, this edge land in the bucket. The last bucket also takes everything above it. */
+    static double getBucketUpperEdge(int bucket) { return getBucketEdge(bucket, 1); }
+    static int getBucket(double microseconds)
+    {
+        const double largestValue = static_cast<double>(juce::uint64(1) << (maxExponent + 1));
+        const juce::uint64 value = static_cast<juce::uint64>(juce::jlimit(0.0, largestValue, microseconds));
+        if (value < static_cast<juce::uint64>(numSubBuckets))
+            return static_cast<int>(value);
+        int exponent = maxExponent + 1;
+        while ((value >> exponent) == 0)
+            --exponent;
+        if (exponent > maxExponent)
+            return numBuckets - 1;
+        const int octave = exponent - subBucketBits;
+        return numSubBuckets + octave * numSubBuckets + static_cast<int>(value >> octave) - numSubBuckets;
+    }
+    /**
+     Index of the bucket holding a percentile of the counts returned by count_bucket(i), or -1 if there are none.
+     */
+    template <typename CountBucket>
+    static int findPercentileBucket(double percentile, CountBucket&& count_bucket)
+    {
+        std::array<juce::uint64, numBuckets> counts;
+        juce::uint64 total = 0;
+        for (int i = 0; i < numBuckets; ++i)
+        {
+            counts[static_cast<size_t>(i)] = count_bucket(i);
+            total += counts[static_cast<size_t>(i)];
+        }
+        if (total == 0)
+            return -1;
+        const double target = juce::jlimit(0.0, 100.0, percentile) / 100.0 * static_cast<double>(total);
+        juce::uint64 seen = 0;
+        for (int i = 0; i < numBuckets; ++i)
+        {
+            seen += counts[static_cast<size_t>(i)];
+            if (seen > 0 && static_cast<double>(seen) >= target)
+                return i;
+        }
+        return numBuckets - 1;
+    }
+
+private:
+    static double getBucketEdge(int bucket, int offset)
+    {
+        if (bucket < numSubBuckets)
+            return static_cast<double>(bucket + offset);
+        const int octave = (bucket - numSubBuckets) / numSubBuckets;
+        const int subBucket = (bucket - numSubBuckets) % numSubBuckets;
+        return static_cast<double>(static_cast<juce::uint64>(numSubBuckets + subBucket + offset) << octave);
+    }
+    
+    std::array<std::atomic<juce::uint64>, numBuckets> buckets {};
+    std::atomic<juce::uint64> count { 0 };
+    std::atomic<juce::uint64> totalMicroseconds { 0 };
+    std::atomic<double> maxMicroseconds { 0 };
+};
+
+/**
+ Two LatencyHistograms taking turns, so percentiles cover only recent samples.
+ Whoever owns the window calls rotate() every half window, the percentile then always covers between a half and a full window.
+ */
+class SlidingLatencyWindow
+{
+public:
+    void add(double microseconds) { halves[current.load(std::memory_order_relaxed)].add(microseconds); }
+    void rotate()
+    {
+        const size_t next = 1 - current.load();
+        halves[next].reset();
+        current.store(next);
+    }
+    void reset()
+    {
+        halves[0].reset();
+        halves[1].reset();
+    }
+    juce::uint64 getCount() const { return halves[0].getCount() + halves[1].getCount(); }
+    double getPercentile(double percentile) const
+    {
+        const int bucket = LatencyHistogram::findPercentileBucket(percentile, [this](int i) { return halves[0].getBucketCount(i) + halves[1].getBucketCount(i); });
+        return bucket < 0 ? 0.0 : juce::jmin(LatencyHistogram::getBucketUpperEdge(bucket), juce::jmax(halves[0].getMaxMicroseconds(), halves[1].getMaxMicroseconds()));
+    }
+    /** Lower edge of the bucket holding the percentile, the true percentile is never below it. */
+    double getPercentileLowerBound(double percentile) const
+    {
+        const int bucket = LatencyHistogram::findPercentileBucket(percentile, [this](int i) { return halves[0].getBucketCount(i) + halves[1].getBucketCount(i); });
+        return bucket < 0 ? 0.0 : LatencyHistogram::getBucketLowerEdge(bucket);
+    }
+private:
+    std::array<LatencyHistogram, 2> halves;
+    std::atomic<size_t> current { 0 };
+};
+
+} // JJS
@@ -14,7 +14,7 @@ template<typename T>
 class LockFreeFifo
 {
 public:
-    LockFreeFifo(int size) : fifo(size), buffer(size) {}
+    LockFreeFifo(int size) : fifo(size), buffer(static_cast<size_t>(size)) {}
     
     template<typename U>
     bool push(U&& item)
@@ -25,7 +25,7 @@ public:
         if (size1 + size2 <= 0)
             return false;
         
-        buffer[start1] = std::forward<U>(item);
+        buffer[static_cast<size_t>(start1)] = std::forward<U>(item);
         fifo.finishedWrite(1);
         
         return true;
@@ -37,9 +37,9 @@ public:
         fifo.prepareToRead(1, start1, size1, start2, size2);
         
         if (size1 + size2 <= 0)
-            return nullptr;
+            return T();
         
-        T item = std::move(buffer[start1]);
+        T item = std::move(buffer[static_cast<size_t>(start1)]);
         fifo.finishedRead(1);
         
         return item;
@@ -50,7 +50,12 @@ public:
         fifo.reset();
     }
     
-    int getNumItems() { return fifo.getNumReady(); }
+    int getNumItems() const { return fifo.getNumReady(); }
+    int getFreeSpace() const { return fifo.getFreeSpace(); }
+    /**
+     Bytes held by the ring buffer, not counting heap memory owned by the items in it.
+     */
+    size_t getMemoryUsage() const { return sizeof(*this) + buffer.capacity() * sizeof(T); }
     
 private:
     juce::AbstractFifo fifo;
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    OrderedChannel.h
+    Created: 18 Oct 2026 7:12:48pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Job.h"
+
+namespace JJS
+{
+
+/**
+ Delivers the callbacks of its jobs in the order they were pushed, while the jobs themselves still run in parallel.
+ Completions that arrive early wait in a reorder buffer on the message thread. The scheduler only dispatches a job once it is within capacity of the next callback due, so the buffer stays bounded and the job that is due can always run.
+ Dropped jobs deliver their dropped callbacks in order, jobs removed by flush() are skipped.
+
+ Usage:
+ 1. Create a channel with JobSystem::createOrderedChannel(), it lives as long as the JobSystem.
+ 2. Call Job::setOrderedChannel() on every job that should be delivered in order, before pushing it.
+ */
+class OrderedChannel
+{
+public:
+    explicit OrderedChannel(int reorder_capacity) : capacity(static_cast<juce::uint64>(juce::jmax(1, reorder_capacity))) { }
+    
+    int getCapacity() const { return static_cast<int>(capacity); }
+    /**
+     Completions waiting for an earlier job, at most getCapacity() plus any dropped jobs.
+     */
+    int getNumBuffered() const
+    {
+        ScopedLock lock(criticalSection);
+        return static_cast<int>(pending.size());
+    }
+    
+private:
+    friend class JobSystem;
+    
+    juce::uint64 assignSequence() { return nextSequence++; }
+    bool canDispatch(juce::uint64 sequence) const { return sequence < nextToDeliver.load() + capacity; }
+    /**
+     Buffers a finished job, or a gap for a job that will never finish when job is null.
+     */
+    void add(juce::uint64 sequence, std::shared_ptr<Job>&& job)
+    {
+        ScopedLock lock(criticalSection);
+        pending.emplace(sequence, std::move(job));
+    }
+    /**
+     Message thread only. Hands every job that is now due to deliver, in order, and returns how many it delivered.
+     */
+    template <typename Deliver>
+    int deliverReady(Deliver&& deliver)
+    {
+        int numDelivered = 0;
+        for (;;)
+        {
+            std::shared_ptr<Job> job;
+            {
+                ScopedLock lock(criticalSection);
+                auto next = pending.find(nextToDeliver.load());
+                if (next == pending.end())
+                    return numDelivered;
+                job = std::move(next->second);
+                pending.erase(next);
+                nextToDeliver++;
+            }
+            if (job != nullptr) // Gaps left by flushed jobs just advance the order
+            {
+                deliver(*job);
+                numDelivered++;
+            }
+        }
+    }
+    
+    const juce::uint64 capacity;
+    std::atomic<juce::uint64> nextSequence { 0 };
+    std::atomic<juce::uint64> nextToDeliver { 0 };
+    std::map<juce::uint64, std::shared_ptr<Job>> pending;
+    CriticalSection criticalSection { "OrderedChannel" };
+};
+
+} // JJS
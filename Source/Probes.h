@@ -0,0 +1,26 @@
+/*
+  ==============================================================================
+
+    Probes.h
+    Created: 18 Oct 2026 3:05:51pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/**
+ USDT probe points for perf and bpftrace, e.g. `bpftrace -e 'usdt:./App:jjs:job__start { @[arg1] = count(); }'`.
+ Every probe carries a job id, a priority, a queue depth and the job's tag name ("" where there is no job), so traces can be grouped by job type with `str(arg3)`.
+ The queue depth is sampled where the probe fires, except for job__start and job__finish, which run on a worker and report the depth their job was dispatched at. Probes compile to a single nop when nothing is attached, and to nothing at all unless JJS_ENABLE_USDT_PROBES is set.
+
+ Probes: job__push, job__dispatch, job__drop, job__start, job__finish, job__callback, callbacks__drain, container__trigger
+ */
+#if JJS_ENABLE_USDT_PROBES && JUCE_LINUX
+ #include <sys/sdt.h>
+ #define JJS_PROBE(name, job_id, priority, queue_depth, tag_name) DTRACE_PROBE4(jjs, name, static_cast<juce::uint64>(job_id), static_cast<int>(priority), static_cast<int>(queue_depth), static_cast<const char*>(tag_name))
+#else
+ #define JJS_PROBE(name, job_id, priority, queue_depth, tag_name)
+#endif
@@ -10,6 +10,8 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include "Probes.h"
+#include "InstrumentedLock.h"
 
 namespace JJS
 {
@@ -17,7 +19,7 @@ namespace JJS
 /**
  Namespace for RAII protected functions.
  Lambdas with reference captures can be moved around / pushed into a container.
- ScopedFunctions will be removed from the ScopedFunctionContainer when their FunctionScope deconstructs!
+ Functions will be removed from the ScopedFunctionContainer when their FunctionScope deconstructs!
  
  Usage:
  1. Create a ScopedFunctionContainer on your long life object.
@@ -31,15 +33,6 @@ namespace ScopeTrackedFunctions
 template <typename fn = void()>
 class ScopedFunctionContainer;
 
-template <typename fn = void()>
-class ScopedFunction
-{
-public:
-    ScopedFunction(const ScopedFunctionContainer<fn>* _container, const std::function<fn>&& _function) : container(_container), function(_function) { }
-    const ScopedFunctionContainer<fn>* container;
-    const std::function<fn> function;
-};
-
 template <typename fn = void()>
 class FunctionScope
 {
@@ -50,60 +43,210 @@ public:
 private:
     friend class ScopedFunctionContainer<fn>;
     std::vector<ScopedFunctionContainer<fn>*> containers;
-    std::vector<ScopedFunction<fn>> scopedFunctions;
 };
 
+/**
+ Defers triggers of coalescing containers made on this thread while it is alive, then triggers each of those containers once, in the order they were first triggered.
+ JobSystem opens one around each priority's completions in a drain, so a container that many jobs complete into runs its functions at most once per priority per drain. See ScopedFunctionContainer::setCoalescing().
+ */
+class CoalescedTriggerBatch
+{
+public:
+    CoalescedTriggerBatch() : previous(current()) { current() = this; }
+    ~CoalescedTriggerBatch()
+    {
+        current() = previous; // Triggers made by the deferred functions run straight away
+        for (size_t i = 0; i < pending.size(); ++i) // Indexed, as a function may destroy a container that is still pending
+            if (pending[i].container != nullptr)
+                pending[i].trigger(pending[i].container);
+    }
+    
+private:
+    template <typename> friend class ScopedFunctionContainer;
+    struct PendingTrigger
+    {
+        const void* container;
+        void (*trigger)(const void*);
+    };
+    void add(const void* container, void (*trigger)(const void*)) { pending.push_back(PendingTrigger { container, trigger }); }
+    void cancel(const void* container)
+    {
+        for (PendingTrigger& trigger : pending)
+            if (trigger.container == container)
+                trigger.container = nullptr;
+    }
+    static CoalescedTriggerBatch*& current()
+    {
+        thread_local CoalescedTriggerBatch* batch = nullptr;
+        return batch;
+    }
+    
+    CoalescedTriggerBatch* const previous;
+    std::vector<PendingTrigger> pending;
+};
+
+/**
+ Holds the functions of every registered scope, in registration order.
+ Scopes are found through an index, and removed scopes leave a gap that is compacted once gaps make up half of the container, so adding and removing scopes stays constant time at any scale.
+ A removed scope's functions are released straight away, or when the trigger that was running them returns.
+ Functions may add and remove scopes while they are triggered. Functions added during a trigger are held back until it returns, and first run on the next one.
+ Triggering only walks this container's own functions, however many other containers a scope is registered in.
+ */
 template <typename fn>
 class ScopedFunctionContainer
 {
 public:
     ScopedFunctionContainer() = default;
+    ~ScopedFunctionContainer()
+    {
+        if (pendingBatch != nullptr)
+            pendingBatch->cancel(this);
+        ScopedLock lock(criticalSection);
+        // Scopes that outlive the container must not remove themselves from it later
+        for (const ScopeEntry& entry : entries)
+            if (entry.scope != nullptr)
+                entry.scope->containers.erase(std::remove(entry.scope->containers.begin(), entry.scope->containers.end(), this), entry.scope->containers.end());
+        for (const PendingAdd& pending : pendingAdds)
+            pending.scope->containers.erase(std::remove(pending.scope->containers.begin(), pending.scope->containers.end(), this), pending.scope->containers.end());
+    }
     void add(FunctionScope<fn>* scope, std::function<fn>&& function)
     {
-        juce::ScopedLock lock(criticalSection);
-        addFunctionToScope(scope, std::move(function));
-        registerContainerToScope(scope);
+        ScopedLock lock(criticalSection);
+        if (index.find(scope) == index.end() && !hasPendingAdd(scope))
+            scope->containers.push_back(this);
+        numFunctions++;
+        if (triggerDepth > 0)
+        {
+            // The running function may live in the vector this add would grow
+            pendingAdds.push_back(PendingAdd { scope, std::move(function) });
+            return;
+        }
+        addFunction(scope, std::move(function));
     }
     void remove(FunctionScope<fn>* scope)
     {
-        juce::ScopedLock lock(criticalSection);
-        auto iterator = std::remove_if(scopes.begin(), scopes.end(), [scope](FunctionScope<fn>* s) { return s == scope; });
-        scopes.erase(iterator, scopes.end());
+        ScopedLock lock(criticalSection);
+        auto pendingEnd = std::remove_if(pendingAdds.begin(), pendingAdds.end(), [scope](const PendingAdd& pending) { return pending.scope == scope; });
+        numFunctions -= static_cast<size_t>(std::distance(pendingEnd, pendingAdds.end()));
+        pendingAdds.erase(pendingEnd, pendingAdds.end());
+        auto iterator = index.find(scope);
+        if (iterator == index.end())
+            return;
+        ScopeEntry& entry = entries[iterator->second];
+        numFunctions -= entry.functions.size();
+        entry.scope = nullptr;
+        index.erase(iterator);
+        numRemovedEntries++;
+        if (triggerDepth > 0)
+            return; // One of the functions may be running right now, the trigger compacts once it unwinds
+        std::vector<std::function<fn>>().swap(entry.functions); // Release captured state now, the empty entry waits for compaction
+        if (numRemovedEntries * 2 > entries.size())
+            compact();
     }
+    /**
+     A coalescing container triggered while a CoalescedTriggerBatch is open on the calling thread runs its functions once, when the batch closes, however often it was triggered.
+     Triggers outside a batch, and containers of functions that take arguments, are never deferred.
+     */
+    void setCoalescing(bool should_coalesce) { coalescing.store(should_coalesce); }
+    bool isCoalescing() const { return coalescing.load(); }
     template<typename... Args>
     void triggerFunctions(Args... args) const
     {
-        juce::ScopedLock lock(criticalSection);
-        for (FunctionScope<fn>* scope : scopes)
-            for (const ScopedFunction<fn>& scopedFunction : scope->scopedFunctions)
-                if (scopedFunction.container == this)
-                    scopedFunction.function(args...);
+        if constexpr (sizeof...(Args) == 0)
+        {
+            CoalescedTriggerBatch* batch = CoalescedTriggerBatch::current();
+            if (batch != nullptr && coalescing.load())
+            {
+                if (pendingBatch == nullptr)
+                {
+                    pendingBatch = batch;
+                    batch->add(this, [](const void* container)
+                    {
+                        const ScopedFunctionContainer& self = *static_cast<const ScopedFunctionContainer*>(container);
+                        self.pendingBatch = nullptr;
+                        self.triggerFunctions();
+                    });
+                }
+                return;
+            }
+        }
+        ScopedLock lock(criticalSection);
+        JJS_PROBE(container__trigger, reinterpret_cast<juce::pointer_sized_uint>(this), 0, index.size(), "");
+        // While triggerDepth is raised nothing moves or frees a function: adds wait in pendingAdds, and removed scopes keep their functions and are skipped
+        triggerDepth++;
+        for (size_t i = 0; i < entries.size(); ++i)
+            for (size_t f = 0; f < entries[i].functions.size() && entries[i].scope != nullptr; ++f)
+                entries[i].functions[f](args...);
+        if (--triggerDepth > 0)
+            return;
+        for (PendingAdd& pending : pendingAdds)
+            addFunction(pending.scope, std::move(pending.function));
+        pendingAdds.clear();
+        // Scopes removed while functions were running still hold their functions, drop them before anything else can
+        if (numRemovedEntries > 0)
+            compact();
     }
-    int getNumFunctions() const
+    int getNumFunctions() const { return static_cast<int>(numFunctions); }
+    int getNumScopes() const { return static_cast<int>(index.size()); }
+    /**
+     Approximate bytes held by this container's bookkeeping and std::function objects, not counting state the functions captured on the heap.
+     */
+    size_t getMemoryUsage() const
     {
-        int num = 0;
-        for (FunctionScope<fn>* scope : scopes)
-            num += scope->scopedFunctions.size();
-        return num;
+        ScopedLock lock(criticalSection);
+        size_t bytes = sizeof(*this) + entries.capacity() * sizeof(ScopeEntry);
+        for (const ScopeEntry& entry : entries)
+            bytes += entry.functions.capacity() * sizeof(std::function<fn>);
+        bytes += pendingAdds.capacity() * sizeof(PendingAdd);
+        bytes += index.bucket_count() * sizeof(void*) + index.size() * (sizeof(typename decltype(index)::value_type) + 2 * sizeof(void*));
+        return bytes;
     }
-    int getNumScopes() const { return static_cast<int>(scopes.size()); }
 private:
-    void addFunctionToScope(FunctionScope<fn>* scope, std::function<fn>&& function)
+    struct ScopeEntry
     {
-        ScopedFunction<fn> scopedFunction(this, std::move(function));
-        scope->scopedFunctions.push_back(std::move(scopedFunction));
-    }
-    void registerContainerToScope(FunctionScope<fn>* scope)
+        FunctionScope<fn>* scope;
+        std::vector<std::function<fn>> functions;
+    };
+    struct PendingAdd
+    {
+        FunctionScope<fn>* scope;
+        std::function<fn> function;
+    };
+    
+    void addFunction(FunctionScope<fn>* scope, std::function<fn>&& function) const
     {
-        auto iterator = std::find(scopes.begin(), scopes.end(), scope);
-        if (iterator == scopes.end())
+        auto iterator = index.find(scope);
+        if (iterator == index.end())
         {
-            scope->containers.push_back(this);
-            scopes.push_back(scope);
+            iterator = index.emplace(scope, entries.size()).first;
+            entries.push_back(ScopeEntry { scope, {} });
         }
+        entries[iterator->second].functions.push_back(std::move(function));
+    }
+    bool hasPendingAdd(const FunctionScope<fn>* scope) const
+    {
+        return std::any_of(pendingAdds.begin(), pendingAdds.end(), [scope](const PendingAdd& pending) { return pending.scope == scope; });
     }
-    std::vector<FunctionScope<fn>*> scopes;
-    juce::CriticalSection criticalSection;
+    
+    void compact() const
+    {
+        auto iterator = std::remove_if(entries.begin(), entries.end(), [](const ScopeEntry& entry) { return entry.scope == nullptr; });
+        entries.erase(iterator, entries.end());
+        for (size_t i = 0; i < entries.size(); ++i)
+            index[entries[i].scope] = i;
+        numRemovedEntries = 0;
+    }
+    
+    // Mutable so a trigger can compact away scopes its functions removed
+    mutable std::vector<ScopeEntry> entries;
+    mutable std::unordered_map<FunctionScope<fn>*, size_t> index;
+    mutable std::vector<PendingAdd> pendingAdds; // Added while a trigger was running
+    mutable size_t numRemovedEntries { 0 };
+    size_t numFunctions { 0 };
+    mutable int triggerDepth { 0 };
+    std::atomic<bool> coalescing { false };
+    mutable CoalescedTriggerBatch* pendingBatch { nullptr }; // Owned by the thread that opened the batch
+    CriticalSection criticalSection { "ScopedFunctionContainer" };
 };
 
 template <typename fn>
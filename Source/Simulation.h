@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    Simulation.h
+    Created: 18 Oct 2026 6:47:33pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "JobSystem.h"
+
+namespace JJS
+{
+
+/**
+ Deterministic single threaded executor for a JobSystem, running on a virtual clock.
+ The scheduler pass, the message thread callback timer and every job run on the calling thread at exact virtual times, and each job occupies its worker for its declared Job::setSimulatedDuration().
+ The same pushes in the same order always give the same dispatch order and latencies, so starvation, priority inversion and queue blowups can be replayed and asserted on.
+
+ Usage:
+ 1. Create a Simulation, and push jobs to getJobSystem() with simulated durations.
+ 2. Call advance() or runUntilIdle() to move virtual time forward, pushing more jobs in between as the workload requires.
+ 3. Assert on getTime(), callback order, and the JobSystem statistics, which all use virtual time.
+
+ Jobs run at the end of their simulated duration, and the scheduler gets a pass as soon as one finishes, as the real scheduler is woken when a worker frees up.
+ Callbacks run when the virtual timer fires, on the calling thread.
+ */
+class Simulation : SimulationDriver
+{
+public:
+    Simulation(int num_concurrent_jobs, int num_spare_workers = 0, double scheduler_interval_ms = 2.0, double timer_interval_ms = 2.0)
+    : schedulerIntervalMs(scheduler_interval_ms), timerIntervalMs(timer_interval_ms), jobSystem(*this, num_concurrent_jobs, num_spare_workers) { }
+
+    JobSystem& getJobSystem() { return jobSystem; }
+    double getTime() const override { return time; }
+
+    /**
+     Runs every scheduler pass, job completion and timer callback due within the next duration_ms of virtual time.
+     */
+    void advance(double duration_ms)
+    {
+        const double endTime = time + juce::jmax(0.0, duration_ms);
+        while (true)
+        {
+            const double nextTime = juce::jmin(nextSchedulerTime, nextTimerTime, getNextCompletionTime());
+            if (nextTime > endTime)
+                break;
+            time = nextTime;
+            // A worker freeing up wakes the real scheduler straight away, so it gets a pass here too
+            const bool workerFreed = completeDueJobs();
+            if (workerFreed || time >= nextSchedulerTime)
+            {
+                while (!jobSystem.processJobs()) { }
+                nextSchedulerTime = time + schedulerIntervalMs;
+            }
+            if (time >= nextTimerTime)
+            {
+                jobSystem.timerCallback();
+                nextTimerTime = time + timerIntervalMs;
+            }
+        }
+        time = endTime;
+    }
+
+    /**
+     Advances until nothing is queued, running or waiting for its callback, or until max_duration_ms passed. Returns true if the system went idle.
+     */
+    bool runUntilIdle(double max_duration_ms)
+    {
+        const double endTime = time + max_duration_ms;
+        while (time < endTime)
+        {
+            advance(juce::jmin(schedulerIntervalMs, endTime - time));
+            if (isIdle())
+                return true;
+        }
+        return isIdle();
+    }
+
+    bool isIdle() const
+    {
+        return running.empty() && jobSystem.inputJobs.getNumItems() == 0 && !jobSystem.hasOverflowInputJobs.load() && jobSystem.prioritizedJobs.empty() && jobSystem.parkedJobs.empty()
+            && jobSystem.finishedJobs.getNumItems() == 0 && !jobSystem.hasOverflowFinishedJobs.load() && jobSystem.progressCallbackFIFO.getNumItems() == 0 && !jobSystem.hasOverflowProgressCallbacks.load()
+            && !jobSystem.hasOrderedGaps.load();
+    }
+
+private:
+    struct RunningJob
+    {
+        double endTime;
+        juce::uint64 order;
+        std::function<void()> work;
+    };
+
+    void startJob(std::function<void()>&& work, double duration_ms) override
+    {
+        running.push_back(RunningJob { time + juce::jmax(0.0, duration_ms), nextOrder++, std::move(work) });
+    }
+    int getNumRunningJobs() const override { return static_cast<int>(running.size()); }
+    void cancelAllJobs() override { running.clear(); }
+
+    double getNextCompletionTime() const
+    {
+        double next = std::numeric_limits<double>::max();
+        for (const RunningJob& job : running)
+            next = juce::jmin(next, job.endTime);
+        return next;
+    }
+
+    /** Returns true if any job finished. */
+    bool completeDueJobs()
+    {
+        // Finish in end time order, ties in dispatch order
+        bool anyCompleted = false;
+        while (true)
+        {
+            auto due = running.end();
+            for (auto it = running.begin(); it != running.end(); ++it)
+                if (it->endTime <= time && (due == running.end() || it->endTime < due->endTime || (it->endTime <= due->endTime && it->order < due->order)))
+                    due = it;
+            if (due == running.end())
+                return anyCompleted;
+            std::function<void()> work = std::move(due->work);
+            running.erase(due);
+            work();
+            anyCompleted = true;
+        }
+    }
+
+    const double schedulerIntervalMs;
+    const double timerIntervalMs;
+    double time { 0 };
+    double nextSchedulerTime { 0 };
+    double nextTimerTime { 0 };
+    juce::uint64 nextOrder { 0 };
+    std::vector<RunningJob> running;
+    JobSystem jobSystem; // Declared last, so it cancels its running jobs before they go
+};
+
+} // JJS
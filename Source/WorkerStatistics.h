@@ -0,0 +1,239 @@
+/*
+  ==============================================================================
+
+    WorkerStatistics.h
+    Created: 18 Oct 2026 4:36:45pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "InstrumentedLock.h"
+#if JUCE_LINUX || JUCE_MAC
+ #include <time.h>
+#endif
+
+namespace JJS
+{
+
+/**
+ CPU time consumed by the calling thread so far, in milliseconds. Falls back to wall time where there is no thread CPU clock.
+ */
+inline double getThreadCpuTimeMs()
+{
+   #if JUCE_LINUX || JUCE_MAC
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0)
+        return static_cast<double>(time.tv_sec) * 1000.0 + static_cast<double>(time.tv_nsec) / 1000000.0;
+   #endif
+    return juce::Time::getMillisecondCounterHiRes();
+}
+
+/**
+ Allocations made through operator new. Only counted when JJS_COUNT_ALLOCATIONS is set, which makes JJS.cpp replace the global operator new.
+ */
+struct AllocationCounts
+{
+    juce::uint64 allocations { 0 };
+    juce::uint64 bytes { 0 };
+};
+
+/**
+ Running allocation count of the calling thread, bumped by the operator new replacements.
+ */
+inline thread_local AllocationCounts threadAllocationCounts;
+
+inline AllocationCounts getThreadAllocationsSince(const AllocationCounts& start)
+{
+    return AllocationCounts { threadAllocationCounts.allocations - start.allocations, threadAllocationCounts.bytes - start.bytes };
+}
+
+/**
+ How one worker spent its time since the statistics were last reset.
+ */
+struct WorkerUtilization
+{
+    int worker { 0 };
+    juce::uint64 jobsRun { 0 };
+    double busyMs { 0 };
+    double idleMs { 0 };
+    double cpuMs { 0 };
+    double utilization { 0 }; // Busy fraction of the elapsed time, 0 - 1
+    juce::uint64 allocations { 0 };    // Zero unless JJS_COUNT_ALLOCATIONS is set
+    juce::uint64 allocatedBytes { 0 };
+};
+
+/**
+ Totals for every job run under one tag, see Job::setTag().
+ */
+struct JobTypeStatistics
+{
+    juce::String name;
+    juce::String category;
+    juce::uint64 jobsRun { 0 };
+    double cpuMs { 0 };
+    double wallMs { 0 };
+    juce::uint64 allocations { 0 };    // Zero unless JJS_COUNT_ALLOCATIONS is set
+    juce::uint64 allocatedBytes { 0 };
+};
+
+/**
+ Totals for every job tagged with one owner, see Job::setOwner().
+ */
+struct OwnerStatistics
+{
+    const void* owner { nullptr };
+    juce::String name;
+    juce::uint64 jobsRun { 0 };
+    double cpuMs { 0 };
+    double wallMs { 0 };
+    double queueWaitMs { 0 };
+};
+
+/**
+ Per job tag totals of one worker. Each worker has its own, merged on read, so workers never share a lock.
+ Keyed by the tag id so the worker side never allocates after a tag was first seen, untagged jobs share id 0.
+ */
+class JobTypeTotals
+{
+public:
+    using Merged = std::unordered_map<juce::uint32, JobTypeStatistics>;
+
+    void add(juce::uint32 tag_id, const char* name, const char* category, double cpu_ms, double wall_ms, const AllocationCounts& allocations)
+    {
+        ScopedLock lock(criticalSection);
+        auto totals = totalsByTag.find(tag_id);
+        if (totals == totalsByTag.end())
+        {
+            JobTypeStatistics statistics;
+            statistics.name = name != nullptr ? name : "Unnamed Job";
+            statistics.category = category;
+            totals = totalsByTag.emplace(tag_id, std::move(statistics)).first;
+        }
+        totals->second.jobsRun++;
+        totals->second.cpuMs += cpu_ms;
+        totals->second.wallMs += wall_ms;
+        totals->second.allocations += allocations.allocations;
+        totals->second.allocatedBytes += allocations.bytes;
+    }
+    /**
+     Adds these totals into the ones collected from the other workers.
+     */
+    void mergeInto(Merged& merged) const
+    {
+        ScopedLock lock(criticalSection);
+        for (const auto& entry : totalsByTag)
+        {
+            auto totals = merged.find(entry.first);
+            if (totals == merged.end())
+            {
+                merged.emplace(entry.first, entry.second);
+                continue;
+            }
+            totals->second.jobsRun += entry.second.jobsRun;
+            totals->second.cpuMs += entry.second.cpuMs;
+            totals->second.wallMs += entry.second.wallMs;
+            totals->second.allocations += entry.second.allocations;
+            totals->second.allocatedBytes += entry.second.allocatedBytes;
+        }
+    }
+    /**
+     Merged totals sorted by category, then name.
+     */
+    static std::vector<JobTypeStatistics> getStatistics(const Merged& merged)
+    {
+        std::vector<JobTypeStatistics> statistics;
+        statistics.reserve(merged.size());
+        for (const auto& entry : merged)
+            statistics.push_back(entry.second);
+        std::sort(statistics.begin(), statistics.end(), [](const JobTypeStatistics& a, const JobTypeStatistics& b)
+        {
+            return a.category != b.category ? a.category < b.category : a.name < b.name;
+        });
+        return statistics;
+    }
+    void reset()
+    {
+        ScopedLock lock(criticalSection);
+        totalsByTag.clear();
+    }
+private:
+    std::unordered_map<juce::uint32, JobTypeStatistics> totalsByTag;
+    CriticalSection criticalSection { "JobSystem Worker Statistics" };
+};
+
+/**
+ Per owner totals of one worker, so a shared JobSystem can tell which component or plugin instance is using it.
+ Each worker has its own, merged on read like JobTypeTotals.
+ */
+class OwnerTotals
+{
+public:
+    struct Totals
+    {
+        const char* name { nullptr };
+        juce::uint64 jobsRun { 0 };
+        double cpuMs { 0 };
+        double wallMs { 0 };
+        double queueWaitMs { 0 };
+    };
+    using Merged = std::unordered_map<const void*, Totals>;
+
+    void add(const void* owner, const char* owner_name, double cpu_ms, double wall_ms, double queue_wait_ms)
+    {
+        ScopedLock lock(criticalSection);
+        Totals& totals = totalsByOwner[owner];
+        if (owner_name != nullptr)
+            totals.name = owner_name;
+        totals.jobsRun++;
+        totals.cpuMs += cpu_ms;
+        totals.wallMs += wall_ms;
+        totals.queueWaitMs += queue_wait_ms;
+    }
+    /**
+     Adds these totals into the ones collected from the other workers.
+     */
+    void mergeInto(Merged& merged) const
+    {
+        ScopedLock lock(criticalSection);
+        for (const auto& entry : totalsByOwner)
+        {
+            Totals& totals = merged[entry.first];
+            if (entry.second.name != nullptr)
+                totals.name = entry.second.name;
+            totals.jobsRun += entry.second.jobsRun;
+            totals.cpuMs += entry.second.cpuMs;
+            totals.wallMs += entry.second.wallMs;
+            totals.queueWaitMs += entry.second.queueWaitMs;
+        }
+    }
+    static std::vector<OwnerStatistics> getStatistics(const Merged& merged)
+    {
+        std::vector<OwnerStatistics> statistics;
+        statistics.reserve(merged.size());
+        for (const auto& entry : merged)
+        {
+            OwnerStatistics owner;
+            owner.owner = entry.first;
+            owner.name = entry.second.name != nullptr ? entry.second.name : (entry.first != nullptr ? "Unnamed Owner" : "No Owner");
+            owner.jobsRun = entry.second.jobsRun;
+            owner.cpuMs = entry.second.cpuMs;
+            owner.wallMs = entry.second.wallMs;
+            owner.queueWaitMs = entry.second.queueWaitMs;
+            statistics.push_back(owner);
+        }
+        return statistics;
+    }
+    void reset()
+    {
+        ScopedLock lock(criticalSection);
+        totalsByOwner.clear();
+    }
+private:
+    Merged totalsByOwner;
+    CriticalSection criticalSection { "JobSystem Worker Statistics" };
+};
+
+} // JJS
@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    ScopeTrackedFunctionsBenchmark.cpp
+    Created: 18 Oct 2026 9:12:05pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "JJS.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+/**
+ Times ScopedFunctionContainer with 1 to 100k scopes, each registered in 1 to 4096 containers, the way many components listen to a few shared models,
+ and reports the containers' own memory per registration. Combinations past 4M registrations are skipped.
+ The concurrent pass destroys every scope on one thread while another keeps triggering the containers, and reports the slowest single scope destruction.
+ */
+namespace
+{
+
+using namespace JJS::ScopeTrackedFunctions;
+using Clock = std::chrono::steady_clock;
+
+double getElapsedMs(Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); }
+
+struct Containers
+{
+    explicit Containers(int num_containers)
+    {
+        for (int i = 0; i < num_containers; ++i)
+            containers.push_back(std::make_unique<ScopedFunctionContainer<void()>>());
+    }
+    std::vector<std::unique_ptr<FunctionScope<void()>>> addScopes(int num_scopes)
+    {
+        std::vector<std::unique_ptr<FunctionScope<void()>>> scopes;
+        scopes.reserve(static_cast<size_t>(num_scopes));
+        for (int i = 0; i < num_scopes; ++i)
+        {
+            scopes.push_back(std::make_unique<FunctionScope<void()>>());
+            for (auto& container : containers)
+                container->add(scopes.back().get(), [this] { calls.fetch_add(1, std::memory_order_relaxed); });
+        }
+        return scopes;
+    }
+    void triggerAll()
+    {
+        for (auto& container : containers)
+            container->triggerFunctions();
+    }
+    size_t getMemoryUsage() const
+    {
+        size_t bytes = 0;
+        for (const auto& container : containers)
+            bytes += container->getMemoryUsage();
+        return bytes;
+    }
+    std::vector<std::unique_ptr<ScopedFunctionContainer<void()>>> containers;
+    std::atomic<juce::uint64> calls { 0 };
+};
+
+struct SequentialResult
+{
+    double addMs { 0 };
+    double triggerMs { 0 };
+    double destroyMs { 0 };
+    double bytesPerRegistration { 0 };
+};
+
+SequentialResult runSequential(int num_scopes, int num_containers, std::mt19937& random)
+{
+    SequentialResult result;
+    Containers containers(num_containers);
+
+    auto start = Clock::now();
+    auto scopes = containers.addScopes(num_scopes);
+    result.addMs = getElapsedMs(start);
+    result.bytesPerRegistration = static_cast<double>(containers.getMemoryUsage()) / (static_cast<double>(num_scopes) * num_containers);
+
+    start = Clock::now();
+    containers.triggerAll();
+    result.triggerMs = getElapsedMs(start);
+    jassert(containers.calls.load() == static_cast<juce::uint64>(num_scopes) * static_cast<juce::uint64>(num_containers));
+
+    // Components go away in no particular order
+    std::shuffle(scopes.begin(), scopes.end(), random);
+    start = Clock::now();
+    scopes.clear();
+    result.destroyMs = getElapsedMs(start);
+    return result;
+}
+
+struct ConcurrentResult
+{
+    double destroyMs { 0 };
+    double slowestDestroyMs { 0 };
+    juce::uint64 triggers { 0 };
+};
+
+ConcurrentResult runConcurrent(int num_scopes, int num_containers, std::mt19937& random)
+{
+    ConcurrentResult result;
+    Containers containers(num_containers);
+    auto scopes = containers.addScopes(num_scopes);
+    std::shuffle(scopes.begin(), scopes.end(), random);
+
+    std::atomic<bool> destroying { true };
+    std::atomic<bool> triggering { false };
+    std::thread trigger([&]
+    {
+        while (destroying.load())
+        {
+            containers.triggerAll();
+            result.triggers++;
+            triggering.store(true);
+        }
+    });
+    while (!triggering.load())
+        std::this_thread::yield();
+
+    const auto start = Clock::now();
+    for (auto& scope : scopes)
+    {
+        const auto scopeStart = Clock::now();
+        scope.reset();
+        result.slowestDestroyMs = juce::jmax(result.slowestDestroyMs, getElapsedMs(scopeStart));
+    }
+    result.destroyMs = getElapsedMs(start);
+    destroying.store(false);
+    trigger.join();
+    return result;
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 random(42);
+    const int scopeCounts[] { 1, 10, 100, 1000, 10000, 100000 };
+    const int containerCounts[] { 1, 16, 256, 4096 };
+    const juce::int64 maxRegistrations = 4 * 1024 * 1024;
+
+    std::printf("Every scope is registered in every container, ns and bytes are per registration, bytes count the containers' own bookkeeping\n\n");
+    std::printf("%10s %8s | %10s %10s %10s %9s %9s | %12s %12s %9s\n", "containers", "scopes", "add ms", "trigger ms", "destroy ms", "ns/reg", "bytes/reg",
+                "conc. dest.", "slowest ms", "triggers");
+    for (int numContainers : containerCounts)
+    {
+        for (int numScopes : scopeCounts)
+        {
+            if (static_cast<juce::int64>(numScopes) * numContainers > maxRegistrations)
+                continue;
+            const SequentialResult sequential = runSequential(numScopes, numContainers, random);
+            const ConcurrentResult concurrent = runConcurrent(numScopes, numContainers, random);
+            const double nsPerRegistration = (sequential.addMs + sequential.destroyMs) * 1000000.0 / (static_cast<double>(numScopes) * numContainers);
+            std::printf("%10d %8d | %10.3f %10.3f %10.3f %9.1f %9.1f | %12.3f %12.3f %9llu\n", numContainers, numScopes, sequential.addMs, sequential.triggerMs, sequential.destroyMs,
+                        nsPerRegistration, sequential.bytesPerRegistration, concurrent.destroyMs, concurrent.slowestDestroyMs, static_cast<unsigned long long>(concurrent.triggers));
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    ScopeTrackedFunctionsTest.cpp
+    Created: 19 Oct 2026 10:02:17am
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "JJS.h"
+#include <cstdio>
+
+/**
+ Functions that add to and remove from their own container while it triggers them. Run it under JJS_SANITIZER=address, where a function freed or moved while it runs is reported.
+ */
+namespace
+{
+
+using namespace JJS::ScopeTrackedFunctions;
+
+bool check(bool condition, const char* failure)
+{
+    if (!condition)
+        std::printf("FAILED: %s\n", failure);
+    return condition;
+}
+
+/** A function growing its own scope's function list, far past any initial capacity, while it runs. */
+bool addToOwnScope()
+{
+    struct State
+    {
+        ScopedFunctionContainer<void()> container;
+        FunctionScope<void()> scope;
+        int numCalls { 0 };
+        int numAdded { 0 };
+    } state;
+    // Captures one pointer, so std::function keeps the lambda inline in the vector the adds grow
+    state.container.add(&state.scope, [s = &state]
+    {
+        s->numCalls++;
+        for (int i = 0; i < 64; ++i)
+        {
+            s->container.add(&s->scope, [s] { s->numCalls++; });
+            s->numAdded++;
+        }
+    });
+    state.container.triggerFunctions();
+    bool passed = check(state.numCalls == 1, "functions added during a trigger ran in it");
+    passed &= check(state.container.getNumFunctions() == 1 + state.numAdded, "functions added during a trigger were lost");
+    state.numCalls = 0;
+    state.container.triggerFunctions(); // The first function adds another 64
+    passed &= check(state.numCalls == 1 + state.numAdded - 64, "functions added during a trigger did not run on the next one");
+    return passed;
+}
+
+/** New scopes registered during a trigger, one of them destroyed before the trigger returns. */
+bool addNewScopes()
+{
+    ScopedFunctionContainer<void()> container;
+    FunctionScope<void()> scope;
+    std::vector<std::unique_ptr<FunctionScope<void()>>> newScopes;
+    int numNewCalls = 0;
+    container.add(&scope, [&]
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            newScopes.push_back(std::make_unique<FunctionScope<void()>>());
+            container.add(newScopes.back().get(), [&numNewCalls] { numNewCalls++; });
+        }
+        newScopes.front().reset(); // Removed before its add was applied
+    });
+    container.triggerFunctions();
+    bool passed = check(container.getNumScopes() == 100, "scopes added during a trigger were not registered");
+    passed &= check(container.getNumFunctions() == 100, "a scope removed before its add was applied kept its function");
+    container.triggerFunctions(); // Adds another 100
+    passed &= check(numNewCalls == 99, "new scopes' functions did not run on the next trigger");
+    newScopes.clear(); // Must remove themselves from the container
+    passed &= check(container.getNumScopes() == 1 && container.getNumFunctions() == 1, "destroyed scopes are still registered");
+    return passed;
+}
+
+/** A function destroying its own scope, and others, while it runs. */
+bool removeWhileRunning()
+{
+    ScopedFunctionContainer<void()> container;
+    std::vector<std::unique_ptr<FunctionScope<void()>>> scopes;
+    int numCalls = 0;
+    for (int i = 0; i < 10; ++i)
+        scopes.push_back(std::make_unique<FunctionScope<void()>>());
+    for (int i = 0; i < 10; ++i)
+        container.add(scopes[static_cast<size_t>(i)].get(), [&, i]
+        {
+            numCalls++;
+            if (i == 2)
+                for (auto& scope : scopes)
+                    scope.reset();
+        });
+    container.triggerFunctions();
+    bool passed = check(numCalls == 3, "removed scopes' functions ran after their removal");
+    passed &= check(container.getNumScopes() == 0 && container.getNumFunctions() == 0, "removed scopes are still registered");
+    return passed;
+}
+
+/** A function triggering its own container again, adding at both depths. */
+bool nestedTrigger()
+{
+    ScopedFunctionContainer<void()> container;
+    FunctionScope<void()> scope;
+    int depth = 0;
+    int numCalls = 0;
+    container.add(&scope, [&]
+    {
+        numCalls++;
+        container.add(&scope, [] { });
+        if (depth++ == 0)
+            container.triggerFunctions();
+    });
+    container.triggerFunctions();
+    bool passed = check(numCalls == 2, "the nested trigger did not run the container's function");
+    passed &= check(container.getNumFunctions() == 3, "functions added at a nested depth were lost");
+    return passed;
+}
+
+} // namespace
+
+int main()
+{
+    bool passed = true;
+    passed &= addToOwnScope();
+    passed &= addNewScopes();
+    passed &= removeWhileRunning();
+    passed &= nestedTrigger();
+    std::printf(passed ? "PASSED\n" : "FAILED\n");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    SimulationTest.cpp
+    Created: 19 Oct 2026 9:21:40am
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "JJS.h"
+#include <cmath>
+#include <cstdio>
+
+/**
+ Checks that a Simulation keeps its workers as busy as the real scheduler would. N jobs of duration d on W simulated workers must finish in about N * d / W,
+ and the longest queue wait must be about the time taken by the jobs ahead of it, however short the jobs are compared to the scheduler tick.
+ */
+namespace
+{
+
+struct Case
+{
+    int numJobs;
+    int numWorkers;
+    double durationMs;
+};
+
+bool runCase(const Case& testCase)
+{
+    JJS::Simulation simulation(testCase.numWorkers);
+    JJS::JobSystem& jobSystem = simulation.getJobSystem();
+    double lastFinish = 0;
+    for (int i = 0; i < testCase.numJobs; ++i)
+    {
+        auto job = std::make_unique<JJS::Job>([&] { lastFinish = juce::jmax(lastFinish, simulation.getTime()); });
+        job->setSimulatedDuration(testCase.durationMs);
+        jobSystem.pushJob(std::move(job));
+    }
+    const bool idle = simulation.runUntilIdle(60000.0);
+
+    // Every job runs at the end of its duration, so the last one finishes once each worker has run its share back to back
+    const int jobsPerWorker = (testCase.numJobs + testCase.numWorkers - 1) / testCase.numWorkers;
+    const double expectedFinish = jobsPerWorker * testCase.durationMs;
+    const double expectedMaxWait = (jobsPerWorker - 1) * testCase.durationMs * 1000.0;
+    const JJS::LatencyHistogram::Summary queueWait = jobSystem.getLatencyStatistics(JJS::Job::Priority::Normal).queueWait;
+    const bool finishOk = std::abs(lastFinish - expectedFinish) <= testCase.durationMs * 0.5 + 0.001;
+    const bool waitOk = queueWait.max <= expectedMaxWait + testCase.durationMs * 500.0 + 1.0;
+    const bool passed = idle && finishOk && waitOk && queueWait.count == static_cast<juce::uint64>(testCase.numJobs);
+    std::printf("%6d jobs x %7.3f ms on %2d workers: finished at %9.3f ms, expected %9.3f, max wait %10.1f us, expected %10.1f  %s\n", testCase.numJobs, testCase.durationMs,
+                testCase.numWorkers, lastFinish, expectedFinish, queueWait.max, expectedMaxWait, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+} // namespace
+
+int main()
+{
+    const Case cases[]
+    {
+        { 100, 2, 0.01 },
+        { 1000, 8, 0.05 },
+        { 64, 4, 1.0 },
+        { 10, 4, 20.0 },
+        { 5000, 16, 0.001 },
+    };
+    bool passed = true;
+    for (const Case& testCase : cases)
+        passed &= runCase(testCase);
+    std::printf(passed ? "PASSED\n" : "FAILED\n");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+    StressTest.cpp
+    Created: 18 Oct 2026 9:47:31pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "JJS.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+/**
+ Multi threaded stress run of a real JobSystem. Producer threads push bursts past every FIFO capacity and reprioritize thousands of handles at a time,
+ jobs flood the progress FIFO, a flusher thread calls flush() while the message thread drains, and components come and go on the message thread.
+ Every job carries its own id, so a job whose callback ran twice, or that got neither a callback nor was flushed, fails the run even if the totals still add up.
+ Fails if a job is lost or delivered twice, or ordered callbacks arrive out of order, and prints the throughput. Most useful built with JJS_SANITIZER=address or thread.
+
+ Usage: StressTest [seconds]
+ */
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Results
+{
+    static constexpr int maxJobs = 1 << 23;
+    Results() : deliveries(maxJobs) { }
+    /** Hands out the next job id, or -1 once every id is used. */
+    int nextJobId()
+    {
+        const int id = numJobIds.fetch_add(1);
+        return id < maxJobs ? id : -1;
+    }
+    int getNumJobIds() const { return juce::jmin(numJobIds.load(), maxJobs); }
+    void delivered(int job_id) { deliveries[static_cast<size_t>(job_id)].fetch_add(1); }
+
+    std::vector<std::atomic<juce::uint8>> deliveries; // Callbacks run per job id, one each or zero if flushed
+    std::atomic<int> numJobIds { 0 };
+    std::atomic<juce::uint64> callbacks { 0 };
+    std::atomic<juce::uint64> droppedCallbacks { 0 };
+    std::atomic<juce::uint64> progressCallbacks { 0 };
+    std::atomic<juce::uint64> containerCallbacks { 0 };
+    std::atomic<juce::uint64> reprioritized { 0 };
+    std::atomic<juce::uint64> flushes { 0 };
+    juce::int64 lastOrdered { -1 }; // Message thread only
+    juce::uint64 outOfOrder { 0 };
+};
+
+class StressJob : public JJS::Job
+{
+public:
+    StressJob(int work_us, int num_updates, std::function<void()>&& job_callback, Priority job_priority)
+    : Job(std::function<void()>(), std::move(job_callback), job_priority), workUs(work_us), numUpdates(num_updates) { }
+    void jobAction() override
+    {
+        for (int update = 0; update < numUpdates; ++update)
+            executeUpdate(static_cast<float>(update) / static_cast<float>(numUpdates));
+        const auto end = Clock::now() + std::chrono::microseconds(workUs);
+        while (Clock::now() < end && !shouldYield())
+            std::this_thread::yield();
+    }
+private:
+    const int workUs;
+    const int numUpdates;
+};
+
+class Producer
+{
+public:
+    Producer(int producer_index, JJS::JobSystem& job_system, JJS::OrderedChannel& ordered_channel, JJS::ScopedFunctionContainer<void()>& container, JJS::ScopedFunctionContainer<void(float)>& progress_container, Results& stress_results)
+    : index(producer_index), jobSystem(job_system), channel(ordered_channel), callbacks(container), progressCallbacks(progress_container), results(stress_results), random(producer_index + 1)
+    {
+    }
+    void run(const std::atomic<bool>& running)
+    {
+        std::vector<JJS::JobHandle> handles;
+        while (running.load())
+        {
+            // Keep the backlog bounded, the run is about contention rather than memory
+            if (jobSystem.getJobCounters().getPending() > 20000)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            const bool burst = random.nextInt(100) == 0;
+            const int numJobs = burst ? 3000 : 1 + random.nextInt(8);
+            for (int i = 0; i < numJobs; ++i)
+            {
+                const int id = results.nextJobId();
+                if (id < 0)
+                    return;
+                handles.push_back(pushJob(id));
+            }
+            if (handles.size() >= 3000)
+            {
+                jobSystem.setPriority(handles, JJS::Job::getPriorityFromIndex(static_cast<size_t>(random.nextInt(static_cast<int>(JJS::Job::numPriorities)))));
+                results.reprioritized += handles.size();
+                handles.clear();
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(random.nextInt(200)));
+        }
+    }
+private:
+    JJS::JobHandle pushJob(int id)
+    {
+        const auto priority = JJS::Job::getPriorityFromIndex(static_cast<size_t>(random.nextInt(static_cast<int>(JJS::Job::numPriorities))));
+        const int workUs = random.nextInt(100);
+        const int numUpdates = random.nextInt(8) == 0 ? 64 : 0;
+        // One producer owns the ordered channel, so its push order is known
+        if (index == 0 && random.nextInt(4) == 0)
+        {
+            const juce::int64 sequence = nextOrdered++;
+            auto checkOrder = [this, sequence]
+            {
+                if (sequence <= results.lastOrdered)
+                    results.outOfOrder++;
+                results.lastOrdered = sequence;
+            };
+            auto job = std::make_unique<StressJob>(workUs, numUpdates, [this, checkOrder, id] { checkOrder(); results.delivered(id); results.callbacks++; }, priority);
+            job->setDroppedCallback([this, checkOrder, id] { checkOrder(); results.delivered(id); results.droppedCallbacks++; });
+            job->setOrderedChannel(channel);
+            return jobSystem.pushJob(std::move(job), &callbacks, &progressCallbacks);
+        }
+        auto job = std::make_unique<StressJob>(workUs, numUpdates, [this, id] { results.delivered(id); results.callbacks++; }, priority);
+        job->setDroppedCallback([this, id] { results.delivered(id); results.droppedCallbacks++; });
+        return jobSystem.pushJob(std::move(job), &callbacks, &progressCallbacks);
+    }
+
+    const int index;
+    JJS::JobSystem& jobSystem;
+    JJS::OrderedChannel& channel;
+    JJS::ScopedFunctionContainer<void()>& callbacks;
+    JJS::ScopedFunctionContainer<void(float)>& progressCallbacks;
+    Results& results;
+    juce::Random random;
+    juce::int64 nextOrdered { 0 };
+};
+
+bool check(bool condition, const char* failure)
+{
+    if (!condition)
+        std::printf("FAILED: %s\n", failure);
+    return condition;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    const double durationMs = (argc > 1 ? juce::jmax(0.1, std::atof(argv[1])) : 3.0) * 1000.0;
+    const int numProducers = 4;
+
+    Results results;
+    JJS::ScopedFunctionContainer<void()> callbacks;
+    JJS::ScopedFunctionContainer<void(float)> progressCallbacks;
+    callbacks.setCoalescing(true);
+    auto jobSystem = std::make_unique<JJS::JobSystem>("JJS Stress", 4, 1);
+    jobSystem->setQueueLimits(JJS::Job::Priority::Background, { 20.0, 2000 });
+    JJS::OrderedChannel& channel = jobSystem->createOrderedChannel(32);
+
+    std::atomic<bool> running { true };
+    std::vector<std::unique_ptr<Producer>> producers;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numProducers; ++i)
+    {
+        producers.push_back(std::make_unique<Producer>(i, *jobSystem, channel, callbacks, progressCallbacks, results));
+        threads.emplace_back([&running, producer = producers.back().get()] { producer->run(running); });
+    }
+    // flush() is documented as callable from any thread, so it races the message thread drain here
+    threads.emplace_back([&]
+    {
+        while (running.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            jobSystem->flush();
+            results.flushes++;
+        }
+    });
+
+    // Components listening to the containers come and go while their jobs are in flight
+    juce::Random random(99);
+    std::vector<std::unique_ptr<JJS::FunctionScope<void()>>> scopes;
+    std::vector<std::unique_ptr<JJS::FunctionScope<void(float)>>> progressScopes;
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::microseconds(static_cast<juce::int64>(durationMs * 1000.0));
+    while (Clock::now() < end)
+    {
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(5);
+        if (!scopes.empty() && random.nextBool())
+        {
+            scopes.erase(scopes.begin() + random.nextInt(static_cast<int>(scopes.size())));
+            progressScopes.erase(progressScopes.begin() + random.nextInt(static_cast<int>(progressScopes.size())));
+        }
+        if (scopes.size() < 64)
+        {
+            scopes.push_back(std::make_unique<JJS::FunctionScope<void()>>());
+            callbacks.add(scopes.back().get(), [&results] { results.containerCallbacks++; });
+            progressScopes.push_back(std::make_unique<JJS::FunctionScope<void(float)>>());
+            progressCallbacks.add(progressScopes.back().get(), [&results](float) { results.progressCallbacks++; });
+        }
+    }
+
+    running.store(false);
+    for (std::thread& thread : threads)
+        thread.join();
+    // Let everything still queued run and deliver
+    const auto drainEnd = Clock::now() + std::chrono::seconds(30);
+    while (jobSystem->getJobCounters().getPending() > 0 && Clock::now() < drainEnd)
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(10);
+    const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    juce::MessageManager::getInstance()->runDispatchLoopUntil(20); // Progress callbacks posted by the last jobs
+
+    const JJS::JobSystem::JobCounters counters = jobSystem->getJobCounters();
+    std::printf("pushed %llu delivered %llu flushed %llu dropped %llu pending %llu\n", (unsigned long long) counters.pushed, (unsigned long long) counters.delivered,
+                (unsigned long long) counters.flushed, (unsigned long long) counters.dropped, (unsigned long long) counters.getPending());
+    std::printf("callbacks %llu dropped callbacks %llu progress %llu container %llu reprioritized %llu flushes %llu\n", (unsigned long long) results.callbacks.load(),
+                (unsigned long long) results.droppedCallbacks.load(), (unsigned long long) results.progressCallbacks.load(), (unsigned long long) results.containerCallbacks.load(),
+                (unsigned long long) results.reprioritized.load(), (unsigned long long) results.flushes.load());
+
+    juce::uint64 numDuplicated = 0;
+    juce::uint64 numNotDelivered = 0;
+    for (int id = 0; id < results.getNumJobIds(); ++id)
+    {
+        const juce::uint8 numDeliveries = results.deliveries[static_cast<size_t>(id)].load();
+        numDuplicated += numDeliveries > 1 ? 1 : 0;
+        numNotDelivered += numDeliveries == 0 ? 1 : 0;
+    }
+    std::printf("%d jobs in %.2f s, %.0f jobs/s delivered, %llu delivered more than once, %llu not delivered\n", results.getNumJobIds(), elapsedSeconds,
+                static_cast<double>(counters.delivered) / elapsedSeconds, (unsigned long long) numDuplicated, (unsigned long long) numNotDelivered);
+
+    bool passed = true;
+    passed &= check(counters.getPending() == 0, "jobs still pending after the drain");
+    passed &= check(numDuplicated == 0, "a job's callback ran more than once");
+    passed &= check(numNotDelivered == counters.flushed, "jobs neither delivered nor flushed"); // Flushed jobs are the only ones allowed no callback
+    passed &= check(static_cast<juce::uint64>(results.getNumJobIds()) == counters.pushed, "job ids handed out != jobs pushed");
+    passed &= check(counters.pushed == counters.delivered + counters.flushed, "pushed != delivered + flushed");
+    passed &= check(results.callbacks.load() + results.droppedCallbacks.load() == counters.delivered, "callbacks run != jobs delivered");
+    passed &= check(results.droppedCallbacks.load() <= counters.dropped, "more dropped callbacks than jobs dropped"); // Dropped jobs can still be flushed before delivery
+    passed &= check(results.outOfOrder == 0, "ordered channel callbacks out of order");
+    jobSystem.reset();
+    std::printf(passed ? "PASSED\n" : "FAILED\n");
+    return passed ? 0 : 1;
+}
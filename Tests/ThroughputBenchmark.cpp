@@ -0,0 +1,250 @@
+/*
+  ==============================================================================
+
+    ThroughputBenchmark.cpp
+    Created: 18 Oct 2026 10:26:14pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "JJS.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+/**
+ Runs identical workloads through a JobSystem, a bare juce::ThreadPool, std::async and a plain mutex and condition variable pool, and prints them side by side.
+ Fan out pushes a batch of independent jobs, fan in has the last of them push one continuation, and the priority mix makes every tenth job Urgent.
+ Latencies are from submit to start on a worker, Urgent jobs are reported on their own. Only a JobSystem knows about priorities, the others run them in submit order.
+ JobSystem runs with callbacks also report the wall time until every callback has run on the message thread.
+ */
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+double getElapsedMs(Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); }
+
+enum class Shape
+{
+    FanOut,
+    FanIn,
+    PriorityMix
+};
+
+struct Workload
+{
+    const char* name;
+    Shape shape;
+    int numJobs;
+    int workUs;
+};
+
+using Submit = std::function<void(std::function<void()>&&, bool is_urgent)>;
+
+class Run
+{
+public:
+    Run(const Workload& run_workload, Submit&& submit_job)
+    : workload(run_workload), submit(std::move(submit_job)), numExpected(run_workload.numJobs + (run_workload.shape == Shape::FanIn ? 1 : 0))
+    {
+    }
+    /** Submits the whole batch, and returns once every job, and the fan in continuation, has finished. */
+    void execute(const std::function<void()>& wait_a_moment)
+    {
+        const auto start = Clock::now();
+        for (int i = 0; i < workload.numJobs; ++i)
+        {
+            const bool isUrgent = workload.shape == Shape::PriorityMix && i % 10 == 9;
+            submit(makeJob(isUrgent), isUrgent);
+        }
+        while (numDone.load() < numExpected)
+            wait_a_moment();
+        wallMs = getElapsedMs(start);
+    }
+    int getNumExpected() const { return numExpected; }
+
+    const Workload& workload;
+    JJS::LatencyHistogram startLatency;
+    JJS::LatencyHistogram urgentStartLatency;
+    double wallMs { 0 };
+    double callbackWallMs { 0 };
+
+private:
+    /** The body every runner executes, so only the dispatch path differs. */
+    std::function<void()> makeJob(bool is_urgent)
+    {
+        const Clock::time_point submitTime = Clock::now();
+        return [this, submitTime, is_urgent]
+        {
+            (is_urgent ? urgentStartLatency : startLatency).add(std::chrono::duration<double, std::micro>(Clock::now() - submitTime).count());
+            const auto end = Clock::now() + std::chrono::microseconds(workload.workUs);
+            while (Clock::now() < end)
+                ;
+            if (workload.shape == Shape::FanIn && numFinished.fetch_add(1) + 1 == workload.numJobs)
+                submit(makeJob(false), false);
+            numDone.fetch_add(1);
+        };
+    }
+
+    const Submit submit;
+    const int numExpected;
+    std::atomic<int> numFinished { 0 };
+    std::atomic<int> numDone { 0 };
+};
+
+/**
+ The simplest pool anyone would write, one locked queue and a condition variable.
+ */
+class MutexPool
+{
+public:
+    explicit MutexPool(int num_threads)
+    {
+        for (int i = 0; i < num_threads; ++i)
+            threads.emplace_back([this] { runWorker(); });
+    }
+    ~MutexPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        condition.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+    void addJob(std::function<void()>&& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        condition.notify_one();
+    }
+private:
+    void runWorker()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this] { return quit || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::function<void()>> jobs;
+    bool quit { false };
+    std::vector<std::thread> threads;
+};
+
+void sleepAMoment() { std::this_thread::sleep_for(std::chrono::microseconds(50)); }
+void runMessageLoop() { juce::MessageManager::getInstance()->runDispatchLoopUntil(1); }
+
+void printRun(const char* runner, const Run& run)
+{
+    const JJS::LatencyHistogram::Summary latency = run.startLatency.getSummary();
+    const juce::String callbackWallMs = run.callbackWallMs > 0 ? juce::String(run.callbackWallMs, 1) : juce::String("-");
+    const juce::String urgentP99 = run.urgentStartLatency.getCount() > 0 ? juce::String(run.urgentStartLatency.getPercentile(99.0), 1) : juce::String("-");
+    std::printf("%-24s %-22s %10.1f %12s %10.0f %10.1f %10.1f %10.1f %12s\n", run.workload.name, runner, run.wallMs, callbackWallMs.toRawUTF8(),
+                run.getNumExpected() / run.wallMs * 1000.0, latency.p50, latency.p99, latency.max, urgentP99.toRawUTF8());
+}
+
+void runJobSystem(const Workload& workload, int num_threads, bool with_callbacks)
+{
+    JJS::JobSystem jobSystem("JJS Benchmark", num_threads);
+    std::atomic<int> numCallbacks { 0 };
+    Run run(workload, [&](std::function<void()>&& job, bool is_urgent)
+    {
+        std::function<void()> callback;
+        if (with_callbacks)
+            callback = [&numCallbacks] { numCallbacks++; };
+        jobSystem.pushJob(std::make_unique<JJS::Job>(std::move(job), std::move(callback), is_urgent ? JJS::Job::Priority::Urgent : JJS::Job::Priority::Normal));
+    });
+    const auto start = Clock::now();
+    run.execute(runMessageLoop);
+    if (with_callbacks)
+    {
+        while (numCallbacks.load() < run.getNumExpected())
+            runMessageLoop();
+        run.callbackWallMs = getElapsedMs(start);
+    }
+    printRun(with_callbacks ? "JobSystem" : "JobSystem, no callbacks", run);
+}
+
+void runThreadPool(const Workload& workload, int num_threads)
+{
+    juce::ThreadPool pool(num_threads);
+    Run run(workload, [&pool](std::function<void()>&& job, bool) { pool.addJob(std::move(job)); });
+    run.execute(sleepAMoment);
+    printRun("juce::ThreadPool", run);
+}
+
+void runAsync(const Workload& workload, int)
+{
+    std::mutex futuresLock;
+    std::vector<std::future<void>> futures;
+    futures.reserve(static_cast<size_t>(workload.numJobs + 1));
+    Run run(workload, [&](std::function<void()>&& job, bool)
+    {
+        std::future<void> future = std::async(std::launch::async, std::move(job));
+        std::lock_guard<std::mutex> lock(futuresLock);
+        futures.push_back(std::move(future));
+    });
+    run.execute(sleepAMoment);
+    std::lock_guard<std::mutex> lock(futuresLock);
+    for (std::future<void>& future : futures)
+        future.wait();
+    printRun("std::async", run);
+}
+
+void runMutexPool(const Workload& workload, int num_threads)
+{
+    MutexPool pool(num_threads);
+    Run run(workload, [&pool](std::function<void()>&& job, bool) { pool.addJob(std::move(job)); });
+    run.execute(sleepAMoment);
+    printRun("mutex + condvar", run);
+}
+
+} // namespace
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    const int numThreads = juce::jmax(2, static_cast<int>(std::thread::hardware_concurrency()) - 2);
+    const Workload workloads[]
+    {
+        { "fan out 10k x 0 us", Shape::FanOut, 10000, 0 },
+        { "fan out 10k x 10 us", Shape::FanOut, 10000, 10 },
+        { "fan out 2k x 200 us", Shape::FanOut, 2000, 200 },
+        { "fan in 10k x 10 us", Shape::FanIn, 10000, 10 },
+        { "priority mix 10k x 10 us", Shape::PriorityMix, 10000, 10 },
+    };
+
+    std::printf("%d worker threads, latencies from submit to start in microseconds\n\n", numThreads);
+    std::printf("%-24s %-22s %10s %12s %10s %10s %10s %10s %12s\n", "workload", "runner", "wall ms", "callback ms", "jobs/s", "p50", "p99", "max", "urgent p99");
+    for (const Workload& workload : workloads)
+    {
+        runJobSystem(workload, numThreads, true);
+        runJobSystem(workload, numThreads, false);
+        runThreadPool(workload, numThreads);
+        runAsync(workload, numThreads);
+        runMutexPool(workload, numThreads);
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    UILoopHarness.cpp
+    Created: 18 Oct 2026 11:08:52pm
+    Author:  Gavin
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "JJS.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/**
+ A 60 Hz UI loop on a Simulation's virtual clock, with JobSystem completions arriving in configurable bursts and progress rates.
+ Every frame advances the simulation by 1/60 s, which runs the callback drains due in that frame, and the real time those drains took is charged to the frame.
+ Callbacks burn real CPU for their configured cost, so the frame time percentiles show what a change to the callback path costs the UI.
+ Burst scenarios also report the slowest frame a burst landed in, as a share of the frame budget.
+ Fails if any job pushed is not delivered by the end, or if a burst never reaches the message thread as one batch of at least half its size. Timings are only reported.
+
+ Usage: UILoopHarness [frames] [frame budget in microseconds]
+ */
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+void burnMicroseconds(int microseconds)
+{
+    const auto end = Clock::now() + std::chrono::microseconds(microseconds);
+    while (Clock::now() < end)
+        ;
+}
+
+struct Scenario
+{
+    const char* name;
+    int jobsPerFrame;          // Steady load, random simulated durations
+    int burstSize;             // Jobs pushed together every burstIntervalFrames, finishing within one timer tick
+    int burstIntervalFrames;
+    int progressUpdatesPerJob;
+    int callbackCostUs;        // Each job's own callback, e.g. updating a model
+    int repaintCostUs;         // Each trigger of the shared view container, e.g. invalidating a component
+    int progressCostUs;        // Each progress callback
+    bool coalesceRepaints;
+};
+
+class ProgressJob : public JJS::Job
+{
+public:
+    ProgressJob(int num_updates, std::function<void()>&& job_callback) : Job(std::function<void()>(), std::move(job_callback)), numUpdates(num_updates) { }
+    void jobAction() override
+    {
+        for (int update = 1; update <= numUpdates; ++update)
+            executeUpdate(static_cast<float>(update) / static_cast<float>(numUpdates));
+    }
+private:
+    const int numUpdates;
+};
+
+bool runScenario(const Scenario& scenario, int num_frames, double frame_budget_us)
+{
+    JJS::Simulation simulation(8);
+    JJS::JobSystem& jobSystem = simulation.getJobSystem();
+    JJS::FunctionScope<void()> view;
+    JJS::FunctionScope<void(float)> progressBar;
+    JJS::ScopedFunctionContainer<void()> repaints;
+    JJS::ScopedFunctionContainer<void(float)> progress;
+    repaints.setCoalescing(scenario.coalesceRepaints);
+    repaints.add(&view, [&scenario] { burnMicroseconds(scenario.repaintCostUs); });
+    progress.add(&progressBar, [&scenario](float) { burnMicroseconds(scenario.progressCostUs); });
+
+    juce::Random random(7);
+    auto pushJob = [&](double duration_ms)
+    {
+        auto job = std::make_unique<ProgressJob>(scenario.progressUpdatesPerJob, [&scenario] { burnMicroseconds(scenario.callbackCostUs); });
+        job->setSimulatedDuration(duration_ms);
+        jobSystem.pushJob(std::move(job), &repaints, scenario.progressUpdatesPerJob > 0 ? &progress : nullptr);
+    };
+
+    const double frameMs = 1000.0 / 60.0;
+    JJS::LatencyHistogram frameTime;
+    int framesOverBudget = 0;
+    double slowestBurstFrameUs = 0;
+    bool burstPending = false;
+    for (int frame = 0; frame < num_frames; ++frame)
+    {
+        for (int i = 0; i < scenario.jobsPerFrame; ++i)
+            pushJob(0.5 + random.nextDouble() * 4.0);
+        if (scenario.burstSize > 0 && frame % scenario.burstIntervalFrames == 0)
+        {
+            for (int i = 0; i < scenario.burstSize; ++i)
+                pushJob(0.01);
+            burstPending = true;
+        }
+
+        const double drainedBefore = jobSystem.getCallbackDrainStatistics().totalMicroseconds;
+        simulation.advance(frameMs);
+        const double frameDrainUs = jobSystem.getCallbackDrainStatistics().totalMicroseconds - drainedBefore;
+        frameTime.add(frameDrainUs);
+        if (frameDrainUs > frame_budget_us)
+            framesOverBudget++;
+        if (burstPending)
+        {
+            slowestBurstFrameUs = juce::jmax(slowestBurstFrameUs, frameDrainUs);
+            burstPending = false;
+        }
+    }
+    simulation.runUntilIdle(60000.0);
+
+    const JJS::LatencyHistogram::Summary frames = frameTime.getSummary();
+    const JJS::JobSystem::CallbackDrainStatistics drains = jobSystem.getCallbackDrainStatistics();
+    const JJS::JobSystem::JobCounters counters = jobSystem.getJobCounters();
+    const juce::String burstFrame = scenario.burstSize > 0 ? juce::String(slowestBurstFrameUs / 1000.0, 2) + " ms, " + juce::String(100.0 * slowestBurstFrameUs / frame_budget_us, 0) + "%"
+                                                           : juce::String("-");
+    std::printf("%-30s %9.1f %9.1f %9.1f %9.1f %8d %9.1f %10d %10llu %18s\n", scenario.name, frames.p50, frames.p95, frames.p99, frames.max, framesOverBudget,
+                drains.p99Microseconds, drains.maxCallbacksPerDrain, (unsigned long long) counters.delivered, burstFrame.toRawUTF8());
+    bool passed = true;
+    if (counters.getPending() != 0 || counters.delivered != counters.pushed)
+    {
+        std::printf("FAILED: %s delivered %llu of %llu jobs\n", scenario.name, (unsigned long long) counters.delivered, (unsigned long long) counters.pushed);
+        passed = false;
+    }
+    // A burst trickling in a few callbacks per drain would hide exactly the hitch the scenario is meant to measure
+    if (scenario.burstSize > 0 && drains.maxCallbacksPerDrain < scenario.burstSize / 2)
+    {
+        std::printf("FAILED: %s delivered at most %d callbacks in one drain, the burst is %d\n", scenario.name, drains.maxCallbacksPerDrain, scenario.burstSize);
+        passed = false;
+    }
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    const int numFrames = argc > 1 ? juce::jmax(1, std::atoi(argv[1])) : 600;
+    const double frameBudgetUs = argc > 2 ? juce::jmax(1.0, std::atof(argv[2])) : 1000000.0 / 60.0;
+    const Scenario scenarios[]
+    {
+        //  name                            per frame  burst  every  updates  callback  repaint  progress  coalesce
+        { "steady trickle",                 20,        0,     1,     0,       20,       50,      0,        false },
+        { "completion burst",               0,         500,   60,    0,       20,       50,      0,        false },
+        { "completion burst, coalesced",    0,         500,   60,    0,       20,       50,      0,        true },
+        { "progress heavy",                 20,        0,     1,     16,      20,       50,      20,       false },
+        { "burst and progress, coalesced",  20,        500,   60,    16,      20,       50,      20,       true },
+    };
+
+    std::printf("%d frames at 60 Hz, frame budget %.0f us, times are message thread drain time per frame in microseconds\n\n", numFrames, frameBudgetUs);
+    std::printf("%-30s %9s %9s %9s %9s %8s %9s %10s %10s %18s\n", "scenario", "p50", "p95", "p99", "max", "> budget", "drain p99", "max/drain", "delivered", "burst frame");
+    bool passed = true;
+    for (const Scenario& scenario : scenarios)
+        passed &= runScenario(scenario, numFrames, frameBudgetUs);
+    return passed ? 0 : 1;
+}